@@ -0,0 +1,462 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDateTime>
+#include <QEventLoop>
+#include <QMap>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+#include <QtTest>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "apiclient.h"
+#include "parcelfilter.h"
+#include "parcelhistory.h"
+#include "parcellist.h"
+#include "parcelparser.h"
+#include "recordingtransport.h"
+#include "replaytransport.h"
+
+// Runs synthetic InPost payloads through the same code ParcelList::load uses.
+// Pass -o results.xml,xml (or the run-benchmarks target) for machine readable output.
+class ParcelListBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void parse_data();
+    void parse();
+    void parseFields_data();
+    void parseFields();
+    void pendingFilter_data();
+    void pendingFilter();
+    void refreshUnchanged_data();
+    void refreshUnchanged();
+    void data_data();
+    void data();
+    void memory_data();
+    void memory();
+    void search_data();
+    void search();
+    void recordReplay();
+    void historyQueries_data();
+    void historyQueries();
+
+private:
+    void sizes();
+    static std::string payload(int count, int multiCompartmentEvery);
+    static QString shipmentNumber(int i);
+    void seedHistory();
+
+private:
+    QMap<int, std::string> _payloads;
+    QMap<int, std::shared_ptr<const ParcelPayload>> _parsed;
+    std::unique_ptr<ApiClient> _historyClient;
+    std::unique_ptr<ParcelHistory> _history;
+};
+
+static const int SIZES[] = { 10, 1000, 50000 };
+
+static const char *STATUSES[] = {
+    "DELIVERED", "READY_TO_PICKUP", "OUT_FOR_DELIVERY", "CONFIRMED", "TAKEN_BY_COURIER",
+    "ADOPTED_AT_SORTING_CENTER", "RETURNED_TO_SENDER", "STACK_IN_BOX_MACHINE", "SOME_FUTURE_STATUS"
+};
+
+static const char *SENDERS[] = {
+    "Allegro", "Zalando", "Amazon", "Empik", "Media Expert", "x-kom", "Jan Kowalski"
+};
+
+void ParcelListBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    for (int count : SIZES) {
+        _payloads[count] = payload(count, 20);
+        _parsed[count] = ParcelParser::parse(_payloads[count], false);
+        QVERIFY(_parsed[count]);
+    }
+}
+
+void ParcelListBenchmark::sizes()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : SIZES) {
+        QTest::newRow(QByteArray::number(count).constData()) << count;
+    }
+}
+
+void ParcelListBenchmark::parse_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::parse()
+{
+    QFETCH(int, count);
+    const std::string &body = _payloads[count];
+
+    QBENCHMARK {
+        ParcelParser::parse(body, false);
+    }
+}
+
+void ParcelListBenchmark::parseFields_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::parseFields()
+{
+    QFETCH(int, count);
+
+    std::vector<std::string> statuses, parcelSizes, types, ownerships;
+    for (int i = 0; i < count; i++) {
+        statuses.push_back(STATUSES[i % (sizeof(STATUSES) / sizeof(*STATUSES))]);
+        parcelSizes.push_back(std::string(1, "ABCX"[i % 4]));
+        types.push_back(i % 3 ? "parcel" : "courier");
+        ownerships.push_back(i % 5 ? "OWN" : "OBSERVED");
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < count; i++) {
+            ParcelList::parseParcelStatus(statuses[i]);
+            ParcelList::parseParcelSize(parcelSizes[i]);
+            ParcelList::parseParcelType(types[i]);
+            ParcelList::parseOwnershipStatus(ownerships[i]);
+        }
+    }
+}
+
+void ParcelListBenchmark::pendingFilter_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::pendingFilter()
+{
+    QFETCH(int, count);
+    ParcelList list;
+    list._listType = ApiClient::Pending;
+
+    QBENCHMARK {
+        list._parcels.clear();
+        list.populate(*_parsed[count]);
+    }
+}
+
+void ParcelListBenchmark::refreshUnchanged_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::refreshUnchanged()
+{
+    QFETCH(int, count);
+    ParcelList list;
+    list._listType = ApiClient::Tracked;
+    list.populate(*_parsed[count]);
+
+    QBENCHMARK {
+        list.populate(*_parsed[count]);
+    }
+}
+
+void ParcelListBenchmark::data_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::data()
+{
+    QFETCH(int, count);
+    ParcelList list;
+    list._listType = ApiClient::Tracked;
+    list.populate(*_parsed[count]);
+
+    const QList<int> roles = list.roleNames().keys();
+    const int rows = list.rowCount();
+
+    QBENCHMARK {
+        for (int row = 0; row < rows; row++) {
+            QModelIndex index = list.index(row);
+            for (int role : roles) {
+                list.data(index, role);
+            }
+        }
+    }
+}
+
+void ParcelListBenchmark::memory_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::memory()
+{
+    QFETCH(int, count);
+    const ParcelPayload &payload = *_parsed[count];
+
+    qint64 bytes = payload.parcels.capacity() * sizeof(ParcelList::Parcel) + payload.compartments.capacity() * sizeof(ShipmentNumber);
+
+    // Strings shared between parcels, like interned sender names, are counted once
+    QSet<const QChar *> strings;
+    auto add = [&bytes, &strings](const QString &string) {
+        if (string.isEmpty() || strings.contains(string.constData())) return;
+
+        strings.insert(string.constData());
+        bytes += sizeof(QArrayData) + (string.capacity() + 1) * sizeof(QChar);
+    };
+
+    for (const ParcelList::Parcel &parcel : payload.parcels) {
+        add(parcel.senderName);
+        add(parcel.openCode);
+        add(parcel.qrCode);
+    }
+
+    // Resident bytes per parcel, reported in place of a timing
+    QTest::setBenchmarkResult(static_cast<qreal>(bytes) / count, QTest::BytesAllocated);
+}
+
+void ParcelListBenchmark::search_data()
+{
+    sizes();
+}
+
+void ParcelListBenchmark::search()
+{
+    QFETCH(int, count);
+    ParcelList list;
+    list._listType = ApiClient::Tracked;
+    list.populate(*_parsed[count]);
+    ParcelFilter filter(&list);
+
+    // A shipment number prefix, a sender substring, then a status filter on top
+    QBENCHMARK {
+        filter.setSearch("60200000");
+        filter.setSearch("zal");
+        filter.setStatuses({ static_cast<int>(ParcelList::ParcelStatus::READY_TO_PICKUP) });
+        filter.setStatuses({});
+        filter.setSearch("");
+    }
+}
+
+std::string ParcelListBenchmark::payload(int count, int multiCompartmentEvery)
+{
+    nlohmann::json parcels = nlohmann::json::array();
+
+    for (int i = 0; i < count; i++) {
+        nlohmann::json parcel;
+        parcel["shipmentNumber"] = shipmentNumber(i).toStdString();
+        parcel["shipmentType"] = i % 3 ? "parcel" : "courier";
+        parcel["status"] = STATUSES[i % (sizeof(STATUSES) / sizeof(*STATUSES))];
+        parcel["parcelSize"] = std::string(1, "ABCX"[i % 4]);
+        parcel["ownershipStatus"] = i % 5 ? "OWN" : "OBSERVED";
+        parcel["openCode"] = std::to_string(100000 + i % 900000);
+        parcel["qrCode"] = "P|" + std::to_string(i) + "|" + std::string(40, 'Q');
+        parcel["sender"]["name"] = SENDERS[i % (sizeof(SENDERS) / sizeof(*SENDERS))];
+        parcel["receiver"]["name"] = "Receiver " + std::to_string(i % 50);
+        parcel["statusHistory"] = nlohmann::json::array({
+            {{"status", "CONFIRMED"}, {"date", "2023-05-01T10:00:00.000Z"}},
+            {{"status", "DELIVERED"}, {"date", "2023-05-03T10:00:00.000Z"}}
+        });
+        parcel["pickUpPoint"] = {{"name", "KRA01M"}, {"location", {{"latitude", 50.06}, {"longitude", 19.94}}}};
+
+        if (multiCompartmentEvery > 0 && i % multiCompartmentEvery == 0) {
+            parcel["multiCompartment"]["uuid"] = "uuid-" + std::to_string(i);
+            parcel["multiCompartment"]["shipmentNumbers"] = { std::to_string(i) + "1", std::to_string(i) + "2" };
+        }
+
+        parcels.push_back(parcel);
+    }
+
+    return nlohmann::json{{"updatedUntil", "2023-05-03T10:00:00.000Z"}, {"more", false}, {"parcels", parcels}}.dump();
+}
+
+QString ParcelListBenchmark::shipmentNumber(int i)
+{
+    return QString("602%1").arg(i, 21, 10, QChar('0'));
+}
+
+// Answers every request the same way, standing in for the network
+class FixedTransport : public HttpTransport
+{
+public:
+    explicit FixedTransport(HttpResponse response) : _response(response) {}
+
+    HttpResponse send(const HttpRequest &) override
+    {
+        return _response;
+    }
+
+private:
+    HttpResponse _response;
+};
+
+void ParcelListBenchmark::recordReplay()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString path = directory.filePath("exchanges.jsonl");
+
+    HttpRequest refresh;
+    refresh.method = "POST";
+    refresh.url = "https://example.org/v1/authenticate";
+    refresh.body = nlohmann::json{{"refreshToken", "secret-refresh"}, {"phoneOS", "Android"}}.dump();
+
+    HttpResponse answer;
+    answer.statusCode = 200;
+    answer.text = nlohmann::json{{"authToken", "secret-auth"}}.dump();
+    answer.headers["etag"] = "\"v1\"";
+
+    HttpRequest parcels;
+    parcels.method = "GET";
+    parcels.url = "https://example.org/v4/parcels/tracked";
+
+    HttpResponse list;
+    list.statusCode = 200;
+    list.text = "{ \"parcels\": [] }";
+
+    {
+        RecordingTransport recording(std::unique_ptr<HttpTransport>(new FixedTransport(answer)), path);
+        QCOMPARE(recording.send(refresh).text, answer.text);
+
+        RecordingTransport listRecording(std::unique_ptr<HttpTransport>(new FixedTransport(list)), path);
+        listRecording.send(parcels);
+    }
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray recorded = file.readAll();
+    QVERIFY(!recorded.contains("secret"));
+    QVERIFY(recorded.contains("Android"));
+    // Other bodies are written as they came, not parsed and dumped again
+    QVERIFY(recorded.contains("{ \\\"parcels\\\": [] }"));
+
+    ReplayTransport replay(path);
+    HttpResponse replayed = replay.send(refresh);
+    QCOMPARE(replayed.statusCode, 200L);
+    QCOMPARE(nlohmann::json::parse(replayed.text).value("authToken", ""), std::string("recorded"));
+
+    refresh.headers["If-None-Match"] = "\"v1\"";
+    QCOMPARE(replay.send(refresh).statusCode, 304L);
+
+    HttpRequest unknown;
+    unknown.method = "GET";
+    unknown.url = "https://example.org/unknown";
+    QCOMPARE(replay.send(unknown).statusCode, 0L);
+}
+
+// Years of history the queries have to stay fast with: a parcel a day or so, each going
+// through the usual statuses over a week
+static const int HISTORY_DAYS = 3 * 365;
+static const int HISTORY_PARCELS = 20000;
+
+static const ParcelList::ParcelStatus HISTORY_STATUSES[] = {
+    ParcelList::ParcelStatus::CONFIRMED, ParcelList::ParcelStatus::DISPATCHED_BY_SENDER,
+    ParcelList::ParcelStatus::COLLECTED_FROM_SENDER, ParcelList::ParcelStatus::ADOPTED_AT_SORTING_CENTER,
+    ParcelList::ParcelStatus::OUT_FOR_DELIVERY, ParcelList::ParcelStatus::READY_TO_PICKUP,
+    ParcelList::ParcelStatus::DELIVERED
+};
+
+void ParcelListBenchmark::seedHistory()
+{
+    if (_history) return;
+
+    _historyClient.reset(new ApiClient(std::unique_ptr<HttpTransport>(new FixedTransport(HttpResponse()))));
+    _history.reset(new ParcelHistory(_historyClient.get()));
+    _history->clear();
+
+    const int statusCount = sizeof(HISTORY_STATUSES) / sizeof(*HISTORY_STATUSES);
+    const qint64 start = QDateTime::currentMSecsSinceEpoch() / 1000 - HISTORY_DAYS * 24 * 60 * 60;
+    ParcelHistory *history = _history.get();
+
+    // One sync a day, behind the clear() on the history thread
+    QtConcurrent::run(&history->_pool, [history, statusCount, start]() {
+        for (int day = 0; day < HISTORY_DAYS; day++) {
+            QVector<ParcelHistory::Entry> entries;
+
+            int first = qMax(0, (day - statusCount + 1) * HISTORY_PARCELS / HISTORY_DAYS);
+            int last = qMin(HISTORY_PARCELS, (day + 1) * HISTORY_PARCELS / HISTORY_DAYS + 1);
+            for (int i = first; i < last; i++) {
+                int step = day - i * HISTORY_DAYS / HISTORY_PARCELS;
+                if (step < 0 || step >= statusCount) continue;
+
+                entries.append({ ShipmentNumber(shipmentNumber(i)), QString(SENDERS[i % (sizeof(SENDERS) / sizeof(*SENDERS))]), HISTORY_STATUSES[step] });
+            }
+
+            history->write(entries, start + day * 24 * 60 * 60);
+        }
+    }).waitForFinished();
+}
+
+void ParcelListBenchmark::historyQueries_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("changedSince") << "changedSince";
+    QTest::newRow("statusDurations") << "statusDurations";
+    QTest::newRow("bySender") << "bySender";
+}
+
+void ParcelListBenchmark::historyQueries()
+{
+    QFETCH(QString, query);
+    seedHistory();
+
+    // Answers arrive on this thread, each run waits for its own
+    int found = 0;
+    QEventLoop loop;
+    auto run = [this, &query, &found, &loop]() {
+        ParcelHistory::ShipmentsHandler shipments = [&found, &loop](QStringList numbers) {
+            found = numbers.size();
+            loop.quit();
+        };
+
+        if (query == "changedSince") {
+            _history->changedSince(QDateTime::currentMSecsSinceEpoch() / 1000 - 7 * 24 * 60 * 60, shipments);
+        } else if (query == "statusDurations") {
+            _history->statusDurations(shipmentNumber(HISTORY_PARCELS / 2), [&found, &loop](QVariantMap durations) {
+                found = durations.size();
+                loop.quit();
+            });
+        } else {
+            _history->bySender(SENDERS[0], shipments);
+        }
+        loop.exec();
+    };
+
+    run();
+    QVERIFY(found > 0);
+
+    QBENCHMARK {
+        run();
+    }
+}
+
+QTEST_GUILESS_MAIN(ParcelListBenchmark)
+
+#include "parcelbenchmark.moc"
@@ -27,4 +27,24 @@ CoverBackground {
         anchors.centerIn: parent
         text: qsTr("Outpost")
     }
+
+    Label {
+        anchors {
+            top: label.bottom
+            topMargin: Theme.paddingMedium
+            horizontalCenter: parent.horizontalCenter
+        }
+        visible: !api.needsAuthorization
+        text: qsTr("%n parcel(s)", "", parcelFilter.count)
+        color: Theme.secondaryColor
+    }
+
+    CoverActionList {
+        enabled: !api.needsAuthorization
+
+        CoverAction {
+            iconSource: "image://theme/icon-cover-refresh"
+            onTriggered: parcelList.reload()
+        }
+    }
 }
@@ -41,13 +41,18 @@ Page {
     Connections {
         target: api
 
-        onRefresh: parcelList.load(listTypeSelect.currentIndex)
         onError: Notices.show(message, Notice.Short, Notice.Center)
         onNeedsAuthorizationChanged: {
             pageStack.replace(Qt.resolvedUrl("PhoneNumberDialog.qml"))
         }
     }
 
+    Connections {
+        target: operations
+
+        onFailed: Notices.show(qsTr("Couldn't change tracking of %1").arg(number), Notice.Short, Notice.Center)
+    }
+
     Timer {
         id: loadTimer
         interval: 100
@@ -73,7 +78,7 @@ Page {
             id: trackDialog
             Dialog {
                 allowedOrientations: Orientation.Portrait
-                onAccepted: api.track(trackNumberField.text)
+                onAccepted: operations.track(trackNumberField.text)
 
                 Column {
                     anchors {
@@ -104,6 +109,8 @@ Page {
         }
 
         PullDownMenu {
+            busy: parcelList.loading
+
             MenuItem {
                 text: qsTr("About")
                 onClicked: pageStack.push(Qt.resolvedUrl("About.qml"))
@@ -121,10 +128,19 @@ Page {
                 onClicked: pageStack.push(trackDialog)
             }
 
+            MenuItem {
+                text: qsTr("Track numbers from clipboard")
+                visible: !api.needsAuthorization && Clipboard.hasText
+                onClicked: {
+                    var result = operations.trackAll(Clipboard.text)
+                    Notices.show(qsTr("Tracking %1 packages, %2 invalid numbers skipped").arg(result.queued.length + result.alreadyQueued.length + result.cancelled.length).arg(result.invalid.length), Notice.Short, Notice.Center)
+                }
+            }
+
             MenuItem {
                 text: qsTr("Reload")
                 visible: !api.needsAuthorization
-                onClicked: parcelList.load(listTypeSelect.currentIndex)
+                onClicked: parcelList.reload()
             }
         }
 
@@ -159,7 +175,7 @@ Page {
         SilicaListView {
             id: parcelListView
             width: parent.width
-            model: parcelList
+            model: parcelFilter
             anchors.top: parent.top
             anchors.topMargin: Math.max(header.height, listTypeSelect.height)
             anchors.bottom: parent.bottom
@@ -167,8 +183,21 @@ Page {
             anchors.right: parent.right
             clip: true
 
+            header: SearchField {
+                width: parent.width
+                placeholderText: qsTr("Search")
+                inputMethodHints: Qt.ImhNoPredictiveText
+                onTextChanged: parcelFilter.search = text
+            }
+
+            BusyIndicator {
+                anchors.centerIn: parent
+                size: BusyIndicatorSize.Large
+                running: parcelList.loading && parcelListView.count === 0
+            }
+
             ViewPlaceholder {
-                enabled: parcelListView.count === 0
+                enabled: parcelListView.count === 0 && !parcelList.loading
                 text: "No content"
                 hintText: "Try selecting different category"
             }
@@ -189,7 +218,7 @@ Page {
                     MenuItem {
                         text: qsTr("Stop tracking")
                         visible: parcelOwnership === 2
-                        onClicked: api.stopTracking(shipmentNumber)
+                        onClicked: operations.stopTracking(shipmentNumber)
                     }
                 }
 
@@ -204,7 +233,7 @@ Page {
                             fillMode: Image.PreserveAspectFit
                             sourceSize.width: Math.min(parent.width, parent.height)
                             sourceSize.height: Math.min(parent.width, parent.height)
-                            source: "image://QZXing/encode/" + qrCode + "?correctionLevel=H&border=true"
+                            source: "image://qrcode/" + qrCode
                             cache: false
                         }
 
@@ -18,27 +18,87 @@ along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
 
 */
 
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QMutexLocker>
+#include <QSaveFile>
 #include <QSettings>
 #include <QString>
-#include <cpr/cpr.h>
+#include <QStringList>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QtConcurrent>
+#include <limits>
 #include "apiclient.h"
 #include "endpoints.h"
+#include "httptransport.h"
+#include "parcelparser.h"
+#include "parcelstore.h"
+#include "syncclient.h"
 
-ApiClient::ApiClient(QObject *parent) : QObject(parent)
+ApiClient::ApiClient(QObject *parent) : ApiClient(HttpTransport::create(), parent)
 {
-    QSettings settings;
+}
 
-    _phoneNumber = settings.value("phoneNumber", "").toString();
-    _authToken = settings.value("authToken", "").toString();
-    _refreshToken = settings.value("refreshToken", "").toString();
+ApiClient::ApiClient(std::unique_ptr<HttpTransport> transport, QObject *parent) : QObject(parent), _transport(std::move(transport))
+{
+    readSettings();
+
+    _requestPool.setMaxThreadCount(4);
+    _storePool.setMaxThreadCount(1);
+
+    _tokenRefreshTimer.setSingleShot(true);
+    connect(&_tokenRefreshTimer, &QTimer::timeout, this, [this]() {
+        QString token = authToken();
+        QtConcurrent::run(&_requestPool, [this, token]() {
+            refreshToken(token);
+        });
+    });
+    connect(this, &ApiClient::authTokenChanged, this, &ApiClient::scheduleTokenRefresh);
+    scheduleTokenRefresh();
+
+    // OUTPOST_METRICS_DUMP names a file the metrics are written to as JSON every
+    // OUTPOST_METRICS_INTERVAL seconds, once a minute by default
+    QString metricsPath = QString::fromLocal8Bit(qgetenv("OUTPOST_METRICS_DUMP"));
+    if (!metricsPath.isEmpty()) {
+        int interval = qEnvironmentVariableIntValue("OUTPOST_METRICS_INTERVAL");
+        connect(&_metricsDumpTimer, &QTimer::timeout, this, [this, metricsPath]() {
+            dumpMetrics(metricsPath);
+        });
+        _metricsDumpTimer.start((interval > 0 ? interval : 60) * 1000);
+    }
+
+    connect(this, &ApiClient::needsAuthorizationChanged, this, [this]() {
+        if (getNeedsAuthorization()) clearCache();
+    });
+}
+
+ApiClient::~ApiClient()
+{
+    _requestPool.waitForDone();
+    _storePool.waitForDone();
 }
 
 bool ApiClient::getNeedsAuthorization()
 {
+    QMutexLocker locker(&_tokenMutex);
     return _authToken == "" || _refreshToken == "";
 }
 
+int ApiClient::getConditionalRequests() const
+{
+    return _conditionalRequests;
+}
+
+int ApiClient::getNotModifiedResponses() const
+{
+    return _notModifiedResponses;
+}
+
 void ApiClient::sendNumber(QString number)
 {
     nlohmann::json payload;
@@ -47,13 +107,13 @@ void ApiClient::sendNumber(QString number)
     payload["phoneNumber"]["prefix"] = "+48";
     payload["phoneNumber"]["value"] = _phoneNumber.toStdString();
 
-    nlohmann::json response = request(Endpoints::SMS_SEND_CODE, payload.dump(), POST, false);
-
-    if (response.is_discarded()) {
-        emit waitingForCode();
-    } else {
-        emit error(tr("Error sending phone number"));
-    }
+    request(Endpoints::SMS_SEND_CODE, payload.dump(), POST, false, [this](Response &response) {
+        if (response.data.is_discarded()) {
+            emit waitingForCode();
+        } else {
+            emit error(tr("Error sending phone number"));
+        }
+    });
 }
 
 void ApiClient::sendCode(QString code)
@@ -64,160 +124,561 @@ void ApiClient::sendCode(QString code)
     payload["phoneNumber"]["prefix"] = "+48";
     payload["phoneNumber"]["value"] = _phoneNumber.toStdString();
 
-    nlohmann::json response = request(Endpoints::SMS_CONFIRM_CODE, payload.dump(), POST, false);
+    request(Endpoints::SMS_CONFIRM_CODE, payload.dump(), POST, false, [this](Response &response) {
+        if (!response.data.empty() && !response.data.is_discarded()) {
+            setTokens(QString::fromStdString(response.data.value("authToken", "")),
+                      QString::fromStdString(response.data.value("refreshToken", "")));
+
+            emit needsAuthorizationChanged();
+            emit authorized();
+        } else {
+            emit error(tr("Error sending code"));
+        }
+    });
+}
 
-    if (!response.empty() && !response.is_discarded()) {
-        _authToken = QString::fromStdString(response["authToken"]);
-        _refreshToken = QString::fromStdString(response["refreshToken"]);
+void ApiClient::logout()
+{
+    // The daemon signs out over the network, this process only forgets the account
+    if (isRemote()) {
+        _sync->logout();
+        _phoneNumber = "";
+        setTokens("", "");
 
-        QSettings settings;
-        settings.setValue("phoneNumber", _phoneNumber);
-        settings.setValue("authToken", _authToken);
-        settings.setValue("refreshToken", _refreshToken);
+        emit needsAuthorizationChanged();
+        return;
+    }
+
+    request(Endpoints::LOGOUT, "", POST, true, [this](Response &) {
+        // The stores belong to the account, queued behind any write still pending
+        QStringList paths;
+        for (const std::string &url : { Endpoints::PARCELS, Endpoints::SENT, Endpoints::RETURNS }) {
+            paths.append(storePath(url));
+        }
+        QtConcurrent::run(&_storePool, [paths]() {
+            for (const QString &path : paths) {
+                ParcelStore::remove(path);
+            }
+        });
+
+        _phoneNumber = "";
+        setTokens("", "");
 
         emit needsAuthorizationChanged();
-        emit authorized();
+    });
+}
+
+void ApiClient::setTracking(QString number, bool tracked, std::function<void(long statusCode)> handler)
+{
+    if (isRemote()) {
+        _sync->setTracking(number, tracked, handler);
+        return;
+    }
+
+    ResponseHandler done = [this, handler](Response &response) {
+        // Deltas don't report parcels that stopped being tracked
+        if (response.statusCode >= 200 && response.statusCode < 300) invalidateCache();
+        handler(response.statusCode);
+    };
+
+    if (tracked) {
+        nlohmann::json payload;
+        payload["shipmentNumber"] = number.toStdString();
+
+        request(Endpoints::OBSERVED_PARCEL, payload.dump(), POST, true, done);
     } else {
-        emit error(tr("Error sending code"));
+        request(Endpoints::OBSERVED_PARCEL + "/" + number.toStdString(), "", DELETE, true, done);
     }
 }
 
-void ApiClient::logout()
+std::string ApiClient::listUrl(ParcelListType parcelType)
 {
-    nlohmann::json response = request(Endpoints::LOGOUT, "", POST, true);
+    switch (parcelType) {
+    case Sent:
+        return Endpoints::SENT;
+    case Returns:
+        return Endpoints::RETURNS;
+    default:
+        return Endpoints::PARCELS;
+    }
+}
 
-    _authToken = "";
-    _refreshToken = "";
-    _phoneNumber = "";
+void ApiClient::getParcels(ParcelListType parcelType, ParcelsHandler handler, bool force)
+{
+    if (isRemote()) {
+        _sync->getParcels(parcelType, force, [this, parcelType, handler, force](std::shared_ptr<const ParcelPayload> data, quint64 remoteRevision) {
+            if (!data) {
+                // The daemon went away on the way, fetch it here instead
+                if (isRemote()) handler(nullptr, 0);
+                else getParcels(parcelType, handler, force);
+                return;
+            }
+
+            quint64 &revision = _remoteRevisions[remoteRevision];
+            if (revision == 0) revision = ++_cacheRevision;
+            handler(data, revision);
+        });
+        return;
+    }
 
-    QSettings settings;
-    settings.setValue("phoneNumber", _phoneNumber);
-    settings.setValue("authToken", _authToken);
-    settings.setValue("refreshToken", _refreshToken);
+    std::string url = listUrl(parcelType);
+    loadStore(url, [this, url, handler, force]() {
+        fetchParcels(url, handler, force);
+    });
+}
 
-    emit needsAuthorizationChanged();
+void ApiClient::getStoredParcels(ParcelListType parcelType, ParcelsHandler handler)
+{
+    // With the daemon running this only reads, the daemon's writes replace the file whole
+    std::string url = listUrl(parcelType);
+    loadStore(url, [this, url, handler]() {
+        const CacheEntry &entry = _cache[QString::fromStdString(url)];
+        handler(entry.data, entry.revision);
+    });
 }
 
-void ApiClient::track(QString number)
+void ApiClient::fetchParcels(const std::string &url, ParcelsHandler handler, bool force)
 {
-    nlohmann::json payload;
-    payload["shipmentNumber"] = number.toStdString();
+    QString key = QString::fromStdString(url);
+    CacheEntry &entry = _cache[key];
+
+    if (!force && entry.data && entry.fetched.isValid() && !entry.fetched.hasExpired(_cacheTtl * 1000)) {
+        std::shared_ptr<const ParcelPayload> data = entry.data;
+        quint64 revision = entry.revision;
+        _metrics.recordCacheLookup(url, NetworkMetrics::CacheHit);
+        QTimer::singleShot(0, this, [handler, data, revision]() {
+            handler(data, revision);
+        });
+        return;
+    }
+
+    // Identical requests already on the way share its response
+    QList<ParcelsHandler> &waiters = _inFlight[key];
+    waiters.append(handler);
+    if (waiters.size() > 1) {
+        _metrics.recordCacheLookup(url, NetworkMetrics::CacheCoalesced);
+        return;
+    }
+    _metrics.recordCacheLookup(url, NetworkMetrics::CacheMiss);
+
+    // Past the watermark only changes are asked for. Deltas can't report parcels that
+    // left the list, so a full response, compared against the store, is fetched now and then.
+    bool delta = !force && !entry.needsFullSync && supportsUpdatedAfter(url) && !entry.store->needsFullSync();
+    std::string requestUrl = url;
+    Validators validators;
+    if (delta) {
+        requestUrl += "?updatedAfter=" + QUrl::toPercentEncoding(QString::fromStdString(entry.store->watermark())).toStdString();
+    } else if (entry.data) {
+        validators = entry.validators;
+    }
 
-    nlohmann::json response = request(Endpoints::OBSERVED_PARCEL, payload.dump(), POST, true);
+    if (!validators.etag.empty() || !validators.lastModified.empty()) {
+        _conditionalRequests++;
+        emit conditionalStatsChanged();
+    }
 
-    if (!response.empty() && !response.is_discarded()) {
-        emit refresh();
-    } else {
-        emit error(tr("Error sending code"));
+    request(requestUrl, "", GET, true, [this, url, key, delta](Response &response) {
+        CacheEntry &entry = _cache[key];
+
+        // The store is gone when the cache was cleared on the way, by a logout
+        if (response.statusCode == 200 && response.parcels && entry.store) {
+            std::string watermark = entry.store->watermark();
+            // A server ignoring updatedAfter answers with the full list and no watermark
+            bool changed = delta && !response.parcels->updatedUntil.empty()
+                    ? entry.store->merge(*response.parcels, _cacheRevision + 1)
+                    : entry.store->replace(*response.parcels, _cacheRevision + 1);
+
+            if (changed) entry.revision = ++_cacheRevision;
+            if (changed || watermark != entry.store->watermark()) saveStore(url, entry);
+            if (!delta) {
+                entry.validators = response.validators;
+                entry.needsFullSync = false;
+            }
+            entry.data = entry.store->payload();
+            entry.fetched.start();
+            if (changed) emit parcelsSynced(entry.data);
+        } else if (response.statusCode == 304 && entry.data) {
+            _notModifiedResponses++;
+            entry.fetched.start();
+            entry.needsFullSync = false;
+            emit conditionalStatsChanged();
+        }
+
+        std::shared_ptr<const ParcelPayload> data = (response.statusCode == 200 || response.statusCode == 304) ? entry.data : nullptr;
+        quint64 revision = entry.revision;
+
+        for (const ParcelsHandler &handler : _inFlight.take(key)) {
+            handler(data, revision);
+        }
+    }, validators, ParcelsBody);
+}
+
+void ApiClient::loadStore(const std::string &url, std::function<void()> handler)
+{
+    QString key = QString::fromStdString(url);
+    if (_cache[key].store) {
+        handler();
+        return;
     }
+
+    QList<std::function<void()>> &waiters = _storeLoads[key];
+    waiters.append(handler);
+    if (waiters.size() > 1) return;
+
+    QString path = storePath(url);
+    quint64 revision = ++_cacheRevision;
+    unsigned int generation = _cacheGeneration;
+
+    auto *watcher = new QFutureWatcher<std::shared_ptr<ParcelStore>>(this);
+    connect(watcher, &QFutureWatcher<std::shared_ptr<ParcelStore>>::finished, this, [this, watcher, url, key, revision, generation]() {
+        watcher->deleteLater();
+        std::shared_ptr<ParcelStore> store = watcher->result();
+        QList<std::function<void()>> waiters = _storeLoads.take(key);
+
+        // Read for the account signed out on the way, the next one reads its own
+        if (generation != _cacheGeneration) {
+            for (const std::function<void()> &waiter : waiters) loadStore(url, waiter);
+            return;
+        }
+
+        CacheEntry &entry = _cache[key];
+        entry.store = store;
+        if (store->payload()) {
+            entry.data = store->payload();
+            entry.revision = revision;
+        }
+
+        for (const std::function<void()> &waiter : waiters) waiter();
+    });
+
+    // Queued behind any write or removal of the file still pending
+    watcher->setFuture(QtConcurrent::run(&_storePool, [path, revision]() {
+        std::shared_ptr<ParcelStore> store = std::make_shared<ParcelStore>();
+        store->read(path, revision);
+        return store;
+    }));
 }
 
-void ApiClient::stopTracking(QString number)
+void ApiClient::saveStore(const std::string &url, const CacheEntry &entry)
 {
-    nlohmann::json response = request(Endpoints::OBSERVED_PARCEL + "/" + number.toStdString(), "", DELETE, true);
+    // Copying the store only copies the shared payload and the row index
+    ParcelStore store = *entry.store;
+    QString path = storePath(url);
 
-    emit refresh();
+    QtConcurrent::run(&_storePool, [store, path]() {
+        store.write(path);
+    });
 }
 
-nlohmann::json ApiClient::getParcels(ParcelListType parcelType)
+QString ApiClient::storePath(const std::string &url) const
 {
-    std::string url;
+    QByteArray account = QCryptographicHash::hash((_phoneNumber + "|" + QString::fromStdString(url)).toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/stores/" + QString::fromLatin1(account) + ".bin";
+}
 
-    switch (parcelType) {
-    case Pending:
-    case Tracked:
-        url = Endpoints::PARCELS;
-        break;
-    case Sent:
-        url = Endpoints::SENT;
-        break;
-    case Returns:
-        url = Endpoints::RETURNS;
-        break;
+bool ApiClient::supportsUpdatedAfter(const std::string &url)
+{
+    // Only the tracked list takes updatedAfter, sent and returns are diffed by hash
+    return url == Endpoints::PARCELS;
+}
+
+void ApiClient::setSyncClient(SyncClient *syncClient)
+{
+    _sync = syncClient;
+
+    // The daemon refreshes tokens it got from the settings, this process must not rotate
+    // them as well. Once it's gone the settings have the latest ones.
+    connect(_sync, &SyncClient::availableChanged, this, [this]() {
+        if (!isRemote()) readSettings();
+        scheduleTokenRefresh();
+    });
+    // The daemon lost the account, to a 401 or a refresh asking to sign in again
+    connect(_sync, &SyncClient::authorizationChanged, this, &ApiClient::reloadAccount);
+    scheduleTokenRefresh();
+}
+
+void ApiClient::reloadAccount()
+{
+    bool needsAuthorization = getNeedsAuthorization();
+    QString phoneNumber = _phoneNumber;
+
+    readSettings();
+    emit authTokenChanged();
+    scheduleTokenRefresh();
+
+    if (_phoneNumber != phoneNumber) clearCache();
+    if (getNeedsAuthorization() != needsAuthorization) {
+        emit needsAuthorizationChanged();
+        if (!getNeedsAuthorization()) emit authorized();
+    }
+}
+
+void ApiClient::readSettings()
+{
+    QSettings settings;
+
+    QMutexLocker locker(&_tokenMutex);
+    _phoneNumber = settings.value("phoneNumber", "").toString();
+    _authToken = settings.value("authToken", "").toString();
+    _refreshToken = settings.value("refreshToken", "").toString();
+    _authExpiry = tokenExpiry(_authToken);
+}
+
+bool ApiClient::isRemote() const
+{
+    return _sync && _sync->isAvailable();
+}
+
+int ApiClient::getCacheTtl() const
+{
+    return _cacheTtl;
+}
+
+void ApiClient::setCacheTtl(int cacheTtl)
+{
+    if (_cacheTtl == cacheTtl) return;
+
+    _cacheTtl = cacheTtl;
+    emit cacheTtlChanged();
+}
+
+QVariantMap ApiClient::getMetrics() const
+{
+    return _metrics.toVariantMap();
+}
+
+void ApiClient::dumpMetrics(const QString &path) const
+{
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(_metrics.toJson());
+        file.commit();
     }
+}
 
-    return request(url, "", GET, true);
+void ApiClient::invalidateCache()
+{
+    for (CacheEntry &entry : _cache) {
+        entry.fetched.invalidate();
+        entry.needsFullSync = true;
+    }
 }
 
-nlohmann::json ApiClient::request(std::string url, std::string body, RequestType type, bool withAuth)
+void ApiClient::clearCache()
 {
-    cpr::Response r;
+    _cache.clear();
+    _cacheGeneration++;
+}
 
-    auto doRequest = [this](std::string url, std::string body, RequestType type, bool withAuth) {
-        cpr::Response r;
-        cpr::Header header;
-        header["Content-Type"] = "application/json; charset=UTF-8";
-        header["User-Agent"] = "InPost-Mobile/3.23.0(32300001) (Android 9; unknown; unknown unknown; en)";
-        if (withAuth)
-            header["Authorization"] = _authToken.toStdString();
+void ApiClient::request(std::string url, std::string body, RequestType type, bool withAuth, ResponseHandler handler, Validators validators, BodyFormat format)
+{
+    auto doRequest = [this, validators](std::string url, std::string body, RequestType type, bool withAuth, QString &token) {
+        static const char *methods[] = { "GET", "POST", "DELETE" };
+
+        HttpRequest request;
+        request.method = methods[type];
+        request.url = url;
+        if (withAuth) {
+            // Don't spend a round-trip on a token that is about to be rejected
+            if (authTokenExpiring()) refreshToken(authToken());
+
+            token = authToken();
+            request.headers["Authorization"] = token.toStdString();
+        }
 
         switch (type) {
         case GET:
-            r = cpr::Get(cpr::Url{url},
-                         header);
+            if (!validators.etag.empty())
+                request.headers["If-None-Match"] = validators.etag;
+            if (!validators.lastModified.empty())
+                request.headers["If-Modified-Since"] = validators.lastModified;
             break;
         case POST:
-            r = cpr::Post(cpr::Url{url},
-                          cpr::Body{body},
-                          header);
+            request.body = body;
             break;
         case DELETE:
-            r = cpr::Delete(cpr::Url{url},
-                          header);
+            break;
         }
 
-        return r;
+        HttpResponse response = _transport->send(request);
+        _metrics.recordResponse(url, response);
+        return response;
     };
 
-    r = doRequest(url, body, type, withAuth);
-    qDebug() << "Status code: " << r.status_code;
+    // The round-trip, including a token refresh on 401, and the body parsing run on the
+    // request pool, the response is handled back on the thread ApiClient lives in.
+    auto *watcher = new QFutureWatcher<Response>(this);
+    connect(watcher, &QFutureWatcher<Response>::finished, this, [this, watcher, handler]() {
+        watcher->deleteLater();
+        Response response = watcher->result();
+
+        switch (response.statusCode) {
+        case 401:
+            setTokens("", "");
+            emit needsAuthorizationChanged();
+            break;
+        case 429:
+            emit error(tr("Error too many requests"));
+            emit rateLimited(response.retryAfter);
+            break;
+        }
+
+        handler(response);
+        emit metricsChanged();
+    });
+
+    watcher->setFuture(QtConcurrent::run(&_requestPool, [this, doRequest, url, body, type, withAuth, format]() {
+        QString token;
+        HttpResponse r = doRequest(url, body, type, withAuth, token);
+        qDebug() << "Status code: " << r.statusCode << "in" << r.elapsed << "s";
+
+        if (r.statusCode == 401) {
+            bool ret = refreshToken(token);
+            if (!ret) return Response();
+
+            _metrics.recordRetry(url);
+            r = doRequest(url, body, type, withAuth, token);
+        }
+
+        Response response;
+        response.statusCode = r.statusCode;
+
+        if (r.statusCode == 200) {
+            if (format == ParcelsBody) {
+                response.parcels = ParcelParser::parse(r.text, url == Endpoints::SENT);
+            } else {
+                response.data = nlohmann::json::parse(r.text, nullptr, false);
+            }
+
+            if (r.headers.count("etag")) response.validators.etag = r.headers["etag"];
+            if (r.headers.count("last-modified")) response.validators.lastModified = r.headers["last-modified"];
+        }
+
+        if (r.statusCode == 429 && r.headers.count("retry-after")) {
+            // Either delta seconds or an HTTP date
+            QString retryAfter = QString::fromStdString(r.headers["retry-after"]).trimmed();
+            bool ok;
+            response.retryAfter = retryAfter.toInt(&ok);
+            if (!ok) {
+                QDateTime date = QDateTime::fromString(retryAfter, Qt::RFC2822Date);
+                response.retryAfter = date.isValid() ? qMax<qint64>(0, QDateTime::currentDateTimeUtc().secsTo(date)) : -1;
+            }
+        }
+
+        return response;
+    }));
+}
+
+bool ApiClient::refreshToken(QString rejectedToken)
+{
+    QMutexLocker refreshLocker(&_refreshMutex);
 
-    if (r.status_code == 401) {
-        bool ret = refreshToken();
-        if (!ret) return {};
+    nlohmann::json payload;
+    QString currentRefreshToken;
+    {
+        QMutexLocker locker(&_tokenMutex);
+
+        // Another request refreshed the token while this one waited for the lock
+        if (_authToken != rejectedToken) return !_authToken.isEmpty();
+        if (_refreshToken.isEmpty()) return false;
 
-        r = doRequest(url, body, type, withAuth);
+        currentRefreshToken = _refreshToken;
+        payload["refreshToken"] = _refreshToken.toStdString();
     }
+    payload["phoneOS"] = PHONE_OS;
 
-    switch (r.status_code) {
-    case 200:
-        qDebug() << QString::fromStdString(r.text);
-        return nlohmann::json::parse(r.text, nullptr, false);
-    case 401:
-        _refreshToken = "";
-        _authToken = "";
+    HttpRequest request;
+    request.method = "POST";
+    request.url = Endpoints::REFRESH_TOKEN;
+    request.body = payload.dump();
+    HttpResponse r = _transport->send(request);
+    _metrics.recordResponse(request.url, r);
+
+    nlohmann::json data = r.statusCode == 200 ? nlohmann::json::parse(r.text, nullptr, false) : nlohmann::json();
+    _metrics.recordTokenRefresh(data.is_object() && !data.value("authToken", "").empty() && !data.value("reauthenticationRequired", false));
+    if (!data.is_object()) return false;
+
+    if (data.value("reauthenticationRequired", false)) {
+        // Saved as well, other processes reading the account must see it is gone
+        setTokens("", "");
         emit needsAuthorizationChanged();
-    case 429:
-        emit error(tr("Error too many requests"));
+
+        return false;
     }
 
-    return {};
+    QString token = QString::fromStdString(data.value("authToken", ""));
+    if (token.isEmpty()) return false;
+
+    // Saved, so the other process gets these and not the ones the server may have rotated away
+    QString refreshToken = QString::fromStdString(data.value("refreshToken", ""));
+    setTokens(token, refreshToken.isEmpty() ? currentRefreshToken : refreshToken);
+
+    return true;
 }
 
-bool ApiClient::refreshToken()
+bool ApiClient::authTokenExpiring() const
 {
-    nlohmann::json payload;
-    payload["refreshToken"] = _refreshToken.toStdString();
-    payload["phoneOS"] = PHONE_OS;
+    QMutexLocker locker(&_tokenMutex);
+    return _authExpiry > 0 && QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() / 1000 >= _authExpiry - TOKEN_REFRESH_MARGIN;
+}
 
-    cpr::Response r = cpr::Post(cpr::Url{Endpoints::REFRESH_TOKEN},
-                  cpr::Body{payload.dump()},
-                  cpr::Header{{"Content-Type", "application/json"}} );
+void ApiClient::scheduleTokenRefresh()
+{
+    qint64 expiry;
+    {
+        QMutexLocker locker(&_tokenMutex);
+        expiry = _refreshToken.isEmpty() ? 0 : _authExpiry;
+    }
 
-    if (r.status_code == 200) {
-        nlohmann::json data = nlohmann::json::parse(r.text);
+    if (expiry == 0 || isRemote()) {
+        _tokenRefreshTimer.stop();
+        return;
+    }
 
-        if (data["reauthenticationRequired"]) {
-            _refreshToken = "";
-            _authToken = "";
-            emit needsAuthorizationChanged();
+    qint64 delay = (expiry - TOKEN_REFRESH_MARGIN) * 1000 - QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+    _tokenRefreshTimer.start(static_cast<int>(qBound<qint64>(0, delay, std::numeric_limits<int>::max())));
+}
 
-            return false;
-        }
+qint64 ApiClient::tokenExpiry(const QString &token)
+{
+    // Only JWTs carry their expiry, other tokens are refreshed after a 401
+    QStringList parts = token.section(' ', -1).split('.');
+    if (parts.size() != 3) return 0;
+
+    QByteArray claims = QByteArray::fromBase64(parts[1].toLatin1(), QByteArray::Base64UrlEncoding);
+    nlohmann::json data = nlohmann::json::parse(claims.constData(), claims.constData() + claims.size(), nullptr, false);
+    if (!data.is_object() || !data.contains("exp") || !data["exp"].is_number()) return 0;
+
+    return data["exp"].get<qint64>();
+}
+
+QString ApiClient::authToken() const
+{
+    QMutexLocker locker(&_tokenMutex);
+    return _authToken;
+}
 
-        _authToken = QString::fromStdString(data["authToken"]);
-        return true;
+void ApiClient::setTokens(QString authToken, QString refreshToken)
+{
+    {
+        QMutexLocker locker(&_tokenMutex);
+        _authToken = authToken;
+        _refreshToken = refreshToken;
+        _authExpiry = tokenExpiry(authToken);
     }
+    emit authTokenChanged();
 
-    return false;
+    // A refresh lands here on a request thread, the phone number and settings belong to the GUI thread
+    if (QThread::currentThread() == thread()) saveTokens();
+    else QMetaObject::invokeMethod(this, "saveTokens", Qt::QueuedConnection);
+}
+
+void ApiClient::saveTokens()
+{
+    QSettings settings;
+    settings.setValue("phoneNumber", _phoneNumber);
+
+    QMutexLocker locker(&_tokenMutex);
+    settings.setValue("authToken", _authToken);
+    settings.setValue("refreshToken", _refreshToken);
 }
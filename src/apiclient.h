@@ -22,14 +22,35 @@ along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
 #define APICLIENT_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include "networkmetrics.h"
+
+class HttpTransport;
+class ParcelStore;
+class SyncClient;
+struct ParcelPayload;
 
 static const std::string PHONE_OS = "Android";
+// Refresh the auth token this many seconds before it expires
+static const int TOKEN_REFRESH_MARGIN = 60;
 
 class ApiClient : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool needsAuthorization READ getNeedsAuthorization NOTIFY needsAuthorizationChanged)
+    Q_PROPERTY(int conditionalRequests READ getConditionalRequests NOTIFY conditionalStatsChanged)
+    Q_PROPERTY(int notModifiedResponses READ getNotModifiedResponses NOTIFY conditionalStatsChanged)
+    Q_PROPERTY(int cacheTtl READ getCacheTtl WRITE setCacheTtl NOTIFY cacheTtlChanged)
+    Q_PROPERTY(QVariantMap metrics READ getMetrics NOTIFY metricsChanged)
 public:
     enum ParcelListType {
         Pending,
@@ -44,19 +65,71 @@ public:
         DELETE
     };
 
+    // Called with the shared parsed payload, or nullptr on failure. The revision changes
+    // only when the payload does, so callers can skip work for data they already have.
+    typedef std::function<void(std::shared_ptr<const ParcelPayload> data, quint64 revision)> ParcelsHandler;
+
     explicit ApiClient(QObject *parent = nullptr);
+    // Tests and benchmarks can serve canned responses through their own transport
+    explicit ApiClient(std::unique_ptr<HttpTransport> transport, QObject *parent = nullptr);
+    ~ApiClient();
 
     bool getNeedsAuthorization();
+    int getConditionalRequests() const;
+    int getNotModifiedResponses() const;
+    int getCacheTtl() const;
+    QVariantMap getMetrics() const;
+    void setCacheTtl(int cacheTtl);
 
     Q_INVOKABLE void sendNumber(QString number);
     Q_INVOKABLE void sendCode(QString code);
     Q_INVOKABLE void logout();
-    Q_INVOKABLE void track(QString number);
-    Q_INVOKABLE void stopTracking(QString number);
-    nlohmann::json getParcels(ParcelListType parcelType);
+    // Starts or stops tracking a parcel right away, OperationQueue is what the UI goes through
+    void setTracking(QString number, bool tracked, std::function<void(long statusCode)> handler);
+    void getParcels(ParcelListType parcelType, ParcelsHandler handler, bool force = false);
+    // What the local store holds for the list, without asking the server
+    void getStoredParcels(ParcelListType parcelType, ParcelsHandler handler);
+    // Parcels and tracking go through the sync daemon whenever it is running
+    void setSyncClient(SyncClient *syncClient);
+    // Picks up the account another process signed in or out of
+    void reloadAccount();
 
 private:
-    nlohmann::json request(std::string url, std::string body, RequestType type, bool withAuth);
+    struct Validators {
+        std::string etag;
+        std::string lastModified;
+    };
+
+    enum BodyFormat {
+        JsonBody,
+        ParcelsBody
+    };
+
+    struct Response {
+        long statusCode = 0;
+        nlohmann::json data;
+        std::shared_ptr<const ParcelPayload> parcels;
+        Validators validators;
+        // Seconds from Retry-After on a 429, -1 when the server gave none
+        int retryAfter = -1;
+    };
+
+    struct CacheEntry {
+        std::shared_ptr<const ParcelPayload> data;
+        Validators validators;
+        quint64 revision = 0;
+        QElapsedTimer fetched;
+        // Persistent copy of the endpoint for the account, loaded on first use
+        std::shared_ptr<ParcelStore> store;
+        // Set when a delta can't be trusted, like after tracking changes
+        bool needsFullSync = false;
+    };
+
+    typedef std::function<void(Response &response)> ResponseHandler;
+
+    void request(std::string url, std::string body, RequestType type, bool withAuth, ResponseHandler handler, Validators validators = Validators(), BodyFormat format = JsonBody);
+    void invalidateCache();
+    void clearCache();
 
 signals:
     void error(QString message);
@@ -64,15 +137,63 @@ signals:
     void waitingForCode();
     void authorized();
     void needsAuthorizationChanged();
-    void refresh();
+    void rateLimited(int seconds);
+    void authTokenChanged();
+    void conditionalStatsChanged();
+    void metricsChanged();
+    void cacheTtlChanged();
+    // A sync changed the content of an endpoint, see ParcelPayload for what changed
+    void parcelsSynced(std::shared_ptr<const ParcelPayload> data);
 
 private:
-    bool refreshToken();
+    bool refreshToken(QString rejectedToken);
+    bool authTokenExpiring() const;
+    void scheduleTokenRefresh();
+    void dumpMetrics(const QString &path) const;
+    static std::string listUrl(ParcelListType parcelType);
+    // Runs the handler once the store of the endpoint is read, off the GUI thread
+    void loadStore(const std::string &url, std::function<void()> handler);
+    void fetchParcels(const std::string &url, ParcelsHandler handler, bool force);
+    void saveStore(const std::string &url, const CacheEntry &entry);
+    QString storePath(const std::string &url) const;
+    static bool supportsUpdatedAfter(const std::string &url);
+    static qint64 tokenExpiry(const QString &token);
+    void readSettings();
+    bool isRemote() const;
+    QString authToken() const;
+    void setTokens(QString authToken, QString refreshToken);
+    // The latest tokens, by the time a queued save runs
+    Q_INVOKABLE void saveTokens();
 
 private:
     QString _phoneNumber;
     QString _authToken;
     QString _refreshToken;
+    mutable QMutex _tokenMutex;
+    // Held for the whole refresh round-trip so concurrent callers share one refresh
+    QMutex _refreshMutex;
+    // Seconds since epoch from the JWT exp claim, 0 when unknown
+    qint64 _authExpiry = 0;
+    QTimer _tokenRefreshTimer;
+    std::unique_ptr<HttpTransport> _transport;
+    QHash<QString, CacheEntry> _cache;
+    QHash<QString, QList<ParcelsHandler>> _inFlight;
+    // Waiting for the store of each endpoint to be read
+    QHash<QString, QList<std::function<void()>>> _storeLoads;
+    // Bumped when the cache is cleared, so a store read for the previous account is dropped
+    unsigned int _cacheGeneration = 0;
+    SyncClient *_sync = nullptr;
+    // Local revisions for the daemon's, the two must not mix
+    QHash<quint64, quint64> _remoteRevisions;
+    quint64 _cacheRevision = 0;
+    int _cacheTtl = 30;
+    int _conditionalRequests = 0;
+    int _notModifiedResponses = 0;
+    NetworkMetrics _metrics;
+    QTimer _metricsDumpTimer;
+    QThreadPool _requestPool;
+    // Single thread, so store writes land in order
+    QThreadPool _storePool;
 };
 
 #endif // APICLIENT_H
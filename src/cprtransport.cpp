@@ -0,0 +1,83 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QString>
+#include <QtGlobal>
+#include "cprtransport.h"
+
+CprTransport::CprTransport() : _sessions(cpr::Header{
+    {"Content-Type", "application/json; charset=UTF-8"},
+    {"User-Agent", "InPost-Mobile/3.23.0(32300001) (Android 9; unknown; unknown unknown; en)"}
+})
+{
+}
+
+HttpResponse CprTransport::send(const HttpRequest &request)
+{
+    // Sessions are leased per method and auth so no body leaks between calls
+    SessionPool::Session session = _sessions.acquire(request.url, request.method + (request.headers.count("Authorization") ? " auth" : ""));
+    session->SetUrl(cpr::Url{request.url});
+    for (const auto &header : request.headers) {
+        session->UpdateHeader(cpr::Header{{header.first, header.second}});
+    }
+
+    cpr::Response r;
+    if (request.method == "GET") {
+        r = session->Get();
+    } else if (request.method == "POST") {
+        session->SetBody(cpr::Body{request.body});
+        r = session->Post();
+    } else if (request.method == "DELETE") {
+        r = session->Delete();
+    }
+
+    HttpResponse response;
+    response.statusCode = r.status_code;
+    response.text = std::move(r.text);
+    response.elapsed = r.elapsed;
+
+    // Cumulative curl timestamps, turned into the time spent in each phase
+    CURL *handle = session->GetCurlHolder()->handle;
+    double nameLookup = 0, connect = 0, appConnect = 0, preTransfer = 0, startTransfer = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME, &nameLookup);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME, &appConnect);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME, &preTransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME, &startTransfer);
+    response.timings.dns = nameLookup;
+    response.timings.connect = qMax(0.0, connect - nameLookup);
+    response.timings.tls = appConnect > 0 ? qMax(0.0, appConnect - connect) : 0;
+    response.timings.ttfb = qMax(0.0, startTransfer - preTransfer);
+
+    double downloaded = 0, uploaded = 0;
+    long headerSize = 0, requestSize = 0;
+    curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD, &downloaded);
+    curl_easy_getinfo(handle, CURLINFO_SIZE_UPLOAD, &uploaded);
+    curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &headerSize);
+    curl_easy_getinfo(handle, CURLINFO_REQUEST_SIZE, &requestSize);
+    response.bytesIn = static_cast<std::uint64_t>(downloaded) + headerSize;
+    response.bytesOut = static_cast<std::uint64_t>(uploaded) + requestSize;
+
+    for (const auto &header : r.header) {
+        response.headers[QString::fromStdString(header.first).toLower().toStdString()] = header.second;
+    }
+
+    return response;
+}
@@ -0,0 +1,38 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CPRTRANSPORT_H
+#define CPRTRANSPORT_H
+
+#include "httptransport.h"
+#include "sessionpool.h"
+
+class CprTransport : public HttpTransport
+{
+public:
+    CprTransport();
+
+    HttpResponse send(const HttpRequest &request) override;
+
+private:
+    SessionPool _sessions;
+};
+
+#endif // CPRTRANSPORT_H
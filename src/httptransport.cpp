@@ -0,0 +1,56 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDebug>
+#include <QString>
+#include <QStringList>
+#include "cprtransport.h"
+#include "httptransport.h"
+#include "recordingtransport.h"
+#include "replaytransport.h"
+
+std::unique_ptr<HttpTransport> HttpTransport::create()
+{
+    QString replay = QString::fromLocal8Bit(qgetenv("OUTPOST_HTTP_REPLAY"));
+    QString record = QString::fromLocal8Bit(qgetenv("OUTPOST_HTTP_RECORD"));
+
+    if (!replay.isEmpty()) {
+        qDebug() << "Replaying HTTP exchanges from" << replay;
+
+        std::unique_ptr<ReplayTransport> transport = std::make_unique<ReplayTransport>(replay);
+        transport->setLatency(qEnvironmentVariableIntValue("OUTPOST_HTTP_LATENCY"));
+
+        // Comma separated status codes served in order before the recording, e.g. 401,429
+        for (const QString &status : QString::fromLocal8Bit(qgetenv("OUTPOST_HTTP_INJECT")).split(",", QString::SkipEmptyParts)) {
+            transport->injectStatus(status.toLong());
+        }
+
+        return transport;
+    }
+
+    std::unique_ptr<HttpTransport> transport = std::make_unique<CprTransport>();
+
+    if (!record.isEmpty()) {
+        qDebug() << "Recording HTTP exchanges to" << record;
+        transport = std::make_unique<RecordingTransport>(std::move(transport), record);
+    }
+
+    return transport;
+}
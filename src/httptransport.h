@@ -0,0 +1,71 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef HTTPTRANSPORT_H
+#define HTTPTRANSPORT_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+typedef std::map<std::string, std::string> HttpHeaders;
+
+struct HttpRequest {
+    std::string method;
+    std::string url;
+    std::string body;
+    HttpHeaders headers;
+};
+
+// Seconds spent in each phase, zero for phases skipped on a reused connection
+struct HttpTimings {
+    double dns = 0;
+    double connect = 0;
+    double tls = 0;
+    // From the request being sent to the first response byte
+    double ttfb = 0;
+};
+
+struct HttpResponse {
+    long statusCode = 0;
+    std::string text;
+    // Header names are lower case
+    HttpHeaders headers;
+    double elapsed = 0;
+    HttpTimings timings;
+    std::uint64_t bytesIn = 0;
+    std::uint64_t bytesOut = 0;
+};
+
+// Blocking HTTP round-trip used by ApiClient from its request pool, send() has to be thread safe
+class HttpTransport
+{
+public:
+    virtual ~HttpTransport() = default;
+
+    virtual HttpResponse send(const HttpRequest &request) = 0;
+
+    // The cpr backend, unless OUTPOST_HTTP_REPLAY names a recording to serve instead.
+    // OUTPOST_HTTP_RECORD names a file every exchange with the real backend is appended to.
+    static std::unique_ptr<HttpTransport> create();
+};
+
+#endif // HTTPTRANSPORT_H
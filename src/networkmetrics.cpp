@@ -0,0 +1,162 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QUrl>
+#include <QVariantList>
+#include <algorithm>
+#include <iterator>
+#include "networkmetrics.h"
+
+namespace {
+
+// Upper bucket bounds in milliseconds
+constexpr int BUCKET_BOUNDS[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+}
+
+void NetworkMetrics::Histogram::add(double seconds)
+{
+    double milliseconds = seconds * 1000;
+    if (buckets.isEmpty()) buckets.fill(0, std::size(BUCKET_BOUNDS) + 1);
+
+    buckets[std::lower_bound(std::begin(BUCKET_BOUNDS), std::end(BUCKET_BOUNDS), milliseconds) - std::begin(BUCKET_BOUNDS)]++;
+    count++;
+    sum += milliseconds;
+    max = std::max(max, milliseconds);
+}
+
+QVariantMap NetworkMetrics::Histogram::toVariantMap() const
+{
+    QVariantList bounds, counts;
+    for (int bound : BUCKET_BOUNDS) bounds.append(bound);
+    for (quint32 bucket : buckets) counts.append(bucket);
+
+    QVariantMap map;
+    map["bucketBounds"] = bounds;
+    map["buckets"] = counts;
+    map["count"] = count;
+    map["mean"] = count > 0 ? sum / count : 0.0;
+    map["max"] = max;
+    return map;
+}
+
+void NetworkMetrics::recordResponse(const std::string &url, const HttpResponse &response)
+{
+    QMutexLocker locker(&_mutex);
+    Endpoint &endpoint = _endpoints[NetworkMetrics::endpoint(url)];
+
+    endpoint.statuses[response.statusCode]++;
+    endpoint.bytesIn += response.bytesIn;
+    endpoint.bytesOut += response.bytesOut;
+    endpoint.total.add(response.elapsed);
+
+    // Transports without timing detail, like replay, only count towards the total
+    if (response.timings.ttfb > 0) {
+        endpoint.dns.add(response.timings.dns);
+        endpoint.connect.add(response.timings.connect);
+        endpoint.tls.add(response.timings.tls);
+        endpoint.ttfb.add(response.timings.ttfb);
+    }
+}
+
+void NetworkMetrics::recordRetry(const std::string &url)
+{
+    QMutexLocker locker(&_mutex);
+    _endpoints[endpoint(url)].retries++;
+}
+
+void NetworkMetrics::recordCacheLookup(const std::string &url, CacheResult result)
+{
+    QMutexLocker locker(&_mutex);
+    Endpoint &endpoint = _endpoints[NetworkMetrics::endpoint(url)];
+
+    switch (result) {
+    case CacheHit:
+        endpoint.cacheHits++;
+        break;
+    case CacheCoalesced:
+        endpoint.cacheCoalesced++;
+        break;
+    case CacheMiss:
+        endpoint.cacheMisses++;
+        break;
+    }
+}
+
+void NetworkMetrics::recordTokenRefresh(bool succeeded)
+{
+    QMutexLocker locker(&_mutex);
+    _tokenRefreshes++;
+    if (!succeeded) _failedTokenRefreshes++;
+}
+
+QVariantMap NetworkMetrics::toVariantMap() const
+{
+    QMutexLocker locker(&_mutex);
+
+    QVariantMap endpoints;
+    for (auto it = _endpoints.constBegin(); it != _endpoints.constEnd(); ++it) {
+        const Endpoint &endpoint = it.value();
+
+        QVariantMap statuses;
+        for (auto status = endpoint.statuses.constBegin(); status != endpoint.statuses.constEnd(); ++status) {
+            statuses[QString::number(status.key())] = status.value();
+        }
+
+        quint32 lookups = endpoint.cacheHits + endpoint.cacheCoalesced + endpoint.cacheMisses;
+
+        QVariantMap map;
+        map["dns"] = endpoint.dns.toVariantMap();
+        map["connect"] = endpoint.connect.toVariantMap();
+        map["tls"] = endpoint.tls.toVariantMap();
+        map["ttfb"] = endpoint.ttfb.toVariantMap();
+        map["total"] = endpoint.total.toVariantMap();
+        map["bytesIn"] = endpoint.bytesIn;
+        map["bytesOut"] = endpoint.bytesOut;
+        map["statuses"] = statuses;
+        map["retries"] = endpoint.retries;
+        map["cacheHits"] = endpoint.cacheHits;
+        map["cacheCoalesced"] = endpoint.cacheCoalesced;
+        map["cacheMisses"] = endpoint.cacheMisses;
+        map["cacheHitRate"] = lookups > 0 ? double(endpoint.cacheHits + endpoint.cacheCoalesced) / lookups : 0.0;
+        endpoints[it.key()] = map;
+    }
+
+    QVariantMap metrics;
+    metrics["endpoints"] = endpoints;
+    metrics["tokenRefreshes"] = _tokenRefreshes;
+    metrics["failedTokenRefreshes"] = _failedTokenRefreshes;
+    return metrics;
+}
+
+QByteArray NetworkMetrics::toJson() const
+{
+    return QJsonDocument::fromVariant(toVariantMap()).toJson();
+}
+
+QString NetworkMetrics::endpoint(const std::string &url)
+{
+    // The path is enough to tell endpoints apart, and keeps parcel numbers out of the keys
+    QString path = QUrl(QString::fromStdString(url)).path();
+    if (path.startsWith("/v1/observedParcel/")) return "/v1/observedParcel/*";
+    return path;
+}
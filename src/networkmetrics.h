@@ -0,0 +1,87 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef NETWORKMETRICS_H
+#define NETWORKMETRICS_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+#include <string>
+#include "httptransport.h"
+
+// Per-endpoint counters and latency histograms, fed from the request pool
+class NetworkMetrics
+{
+public:
+    enum CacheResult {
+        CacheHit,
+        CacheCoalesced,
+        CacheMiss
+    };
+
+    void recordResponse(const std::string &url, const HttpResponse &response);
+    void recordRetry(const std::string &url);
+    void recordCacheLookup(const std::string &url, CacheResult result);
+    void recordTokenRefresh(bool succeeded);
+
+    QVariantMap toVariantMap() const;
+    QByteArray toJson() const;
+
+private:
+    struct Histogram {
+        // Counts per bucket of BUCKET_BOUNDS, the last one catches everything slower
+        QVector<quint32> buckets;
+        quint32 count = 0;
+        double sum = 0;
+        double max = 0;
+
+        void add(double seconds);
+        QVariantMap toVariantMap() const;
+    };
+
+    struct Endpoint {
+        Histogram dns;
+        Histogram connect;
+        Histogram tls;
+        Histogram ttfb;
+        Histogram total;
+        quint64 bytesIn = 0;
+        quint64 bytesOut = 0;
+        QMap<long, quint32> statuses;
+        quint32 retries = 0;
+        quint32 cacheHits = 0;
+        quint32 cacheCoalesced = 0;
+        quint32 cacheMisses = 0;
+    };
+
+    static QString endpoint(const std::string &url);
+
+private:
+    mutable QMutex _mutex;
+    QMap<QString, Endpoint> _endpoints;
+    quint32 _tokenRefreshes = 0;
+    quint32 _failedTokenRefreshes = 0;
+};
+
+#endif // NETWORKMETRICS_H
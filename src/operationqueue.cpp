@@ -0,0 +1,354 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QUrl>
+#include "apiclient.h"
+#include "operationqueue.h"
+#include "parcellist.h"
+
+OperationQueue::OperationQueue(ApiClient *apiClient, ParcelList *parcelList, QObject *parent) : QObject(parent), _apiClient(apiClient), _parcelList(parcelList)
+{
+    _retryTimer.setSingleShot(true);
+    connect(&_retryTimer, &QTimer::timeout, this, &OperationQueue::flush);
+    connect(_apiClient, &ApiClient::authorized, this, &OperationQueue::flush);
+    connect(_apiClient, &ApiClient::needsAuthorizationChanged, this, &OperationQueue::onNeedsAuthorizationChanged);
+
+    read();
+    if (!_operations.isEmpty()) {
+        _parcelList->setTracking(tracking());
+        flush();
+    }
+}
+
+int OperationQueue::getPending() const
+{
+    return _operations.size();
+}
+
+int OperationQueue::getConcurrency() const
+{
+    return _concurrency;
+}
+
+void OperationQueue::setConcurrency(int concurrency)
+{
+    concurrency = qMax(1, concurrency);
+    if (_concurrency == concurrency) return;
+
+    _concurrency = concurrency;
+    emit concurrencyChanged();
+    send();
+}
+
+void OperationQueue::track(QString number)
+{
+    enqueue(Track, number.trimmed());
+}
+
+void OperationQueue::stopTracking(QString number)
+{
+    enqueue(StopTracking, number.trimmed());
+}
+
+QVariantMap OperationQueue::trackAll(const QString &text)
+{
+    QStringList queued, alreadyQueued, cancelled, invalid, duplicate;
+    QSet<QString> seen;
+
+    for (const QString &token : text.split(QRegularExpression("[\\s,;\"']+"), QString::SkipEmptyParts)) {
+        if (!isValidNumber(token)) {
+            invalid.append(token);
+        } else if (seen.contains(token)) {
+            duplicate.append(token);
+        } else {
+            seen.insert(token);
+            switch (add(Track, token)) {
+            case Added:
+                queued.append(token);
+                break;
+            case AlreadyQueued:
+                alreadyQueued.append(token);
+                break;
+            case Cancelled:
+                cancelled.append(token);
+                break;
+            }
+        }
+    }
+
+    // One write and one reload for the whole import, the batch ends with a refresh of its own
+    if (!queued.isEmpty() || !cancelled.isEmpty()) changed();
+    if (!queued.isEmpty()) flush();
+    else if (!cancelled.isEmpty()) _parcelList->refresh();
+
+    QVariantMap result;
+    result["queued"] = queued;
+    result["alreadyQueued"] = alreadyQueued;
+    result["cancelled"] = cancelled;
+    result["invalid"] = invalid;
+    result["duplicate"] = duplicate;
+    return result;
+}
+
+QVariantMap OperationQueue::trackFile(const QString &path)
+{
+    // File pickers hand out URLs
+    QFile file(QUrl(path).isLocalFile() ? QUrl(path).toLocalFile() : path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return QVariantMap();
+
+    return trackAll(QString::fromUtf8(file.readAll()));
+}
+
+bool OperationQueue::isValidNumber(const QString &number)
+{
+    // Same rule as the track dialog
+    if (number.size() != ShipmentNumber::CAPACITY) return false;
+
+    for (const QChar &c : number) {
+        if ((c < '0' || c > '9') && c != '+') return false;
+    }
+    return true;
+}
+
+void OperationQueue::enqueue(OperationType type, const QString &number)
+{
+    if (number.isEmpty()) return;
+
+    switch (add(type, number)) {
+    case Added:
+        changed();
+        flush();
+        break;
+    case Cancelled:
+        // The parcel list shows the server's state again
+        changed();
+        _parcelList->refresh();
+        break;
+    case AlreadyQueued:
+        break;
+    }
+}
+
+OperationQueue::AddResult OperationQueue::add(OperationType type, const QString &number)
+{
+    // A change that hasn't gone out yet is kept, or undone by its opposite. Writing and
+    // refreshing is up to the caller, once for a whole import.
+    for (int i = _operations.size() - 1; i >= 0; i--) {
+        const Operation &operation = _operations[i];
+        if (operation.number != number) continue;
+        if (operation.sending) break;
+        if (operation.type == type) return AlreadyQueued;
+
+        _operations.remove(i);
+        return Cancelled;
+    }
+
+    Operation operation;
+    operation.type = type;
+    operation.number = number;
+    _operations.append(operation);
+    return Added;
+}
+
+void OperationQueue::flush()
+{
+    // A retry waits for its timer
+    if (_retryTimer.isActive() || _apiClient->getNeedsAuthorization()) return;
+
+    for (Operation &operation : _operations) operation.deferred = false;
+    send();
+}
+
+void OperationQueue::onOnline()
+{
+    _retryTimer.stop();
+    _retryInterval = RETRY_INTERVAL;
+    flush();
+}
+
+void OperationQueue::send()
+{
+    if (_retryTimer.isActive() || _apiClient->getNeedsAuthorization()) return;
+
+    // Changes to one parcel go out in order, after the one before has been answered
+    QSet<QString> blocked;
+    for (Operation &operation : _operations) {
+        if (_sending >= _concurrency) return;
+
+        bool ready = !operation.sending && !operation.deferred && !blocked.contains(operation.number);
+        blocked.insert(operation.number);
+        if (!ready) continue;
+
+        operation.sending = true;
+        _sending++;
+
+        QString number = operation.number;
+        _apiClient->setTracking(number, operation.type == Track, [this, number](long statusCode) {
+            onSent(number, statusCode);
+        });
+    }
+
+    if (_sending == 0) onBatchDone();
+}
+
+void OperationQueue::onSent(const QString &number, long statusCode)
+{
+    _sending--;
+
+    for (int i = 0; i < _operations.size(); i++) {
+        Operation &operation = _operations[i];
+        if (operation.number != number || !operation.sending) continue;
+
+        // 409 means the server already had it that way
+        if ((statusCode >= 200 && statusCode < 300) || statusCode == 409) {
+            emit succeeded(number, operation.type);
+            _operations.remove(i);
+            _sent = true;
+        } else if (isTransient(statusCode)) {
+            operation.sending = false;
+            operation.deferred = true;
+        } else {
+            qDebug() << "Dropped" << operation.type << number << "status" << statusCode;
+            emit failed(number, operation.type);
+            _operations.remove(i);
+            _sent = true;
+        }
+
+        emit pendingChanged();
+        break;
+    }
+
+    // Keeps the pipeline full, the batch ends once nothing is left to send
+    send();
+}
+
+void OperationQueue::onBatchDone()
+{
+    bool deferred = false;
+    for (const Operation &operation : _operations) deferred = deferred || operation.deferred;
+
+    if (!_sent && !deferred) return;
+    changed();
+
+    // One refresh for the whole batch, it also brings back what the server refused
+    if (_sent) _parcelList->refresh();
+    _sent = false;
+
+    if (deferred) {
+        _retryTimer.start(_retryInterval * 1000);
+        _retryInterval = qMin(_retryInterval * 2, MAX_RETRY_INTERVAL);
+    } else {
+        _retryInterval = RETRY_INTERVAL;
+    }
+}
+
+void OperationQueue::changed()
+{
+    write();
+    _parcelList->setTracking(tracking());
+    emit pendingChanged();
+}
+
+bool OperationQueue::isTransient(long statusCode)
+{
+    // No response at all, or the server can't take it right now
+    return statusCode == 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500;
+}
+
+QHash<ShipmentNumber, bool> OperationQueue::tracking() const
+{
+    // The last change to each parcel wins
+    QHash<ShipmentNumber, bool> tracking;
+    for (const Operation &operation : _operations) {
+        tracking.insert(ShipmentNumber(operation.number), operation.type == Track);
+    }
+    return tracking;
+}
+
+void OperationQueue::read()
+{
+    QFile file(path());
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic, version, count;
+    stream >> magic >> version;
+    if (magic != MAGIC || version != VERSION) return;
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        quint8 type;
+        Operation operation;
+        stream >> type >> operation.number;
+        operation.type = static_cast<OperationType>(type);
+        _operations.append(operation);
+    }
+
+    if (stream.status() != QDataStream::Ok) _operations.clear();
+}
+
+void OperationQueue::write() const
+{
+    if (_operations.isEmpty()) {
+        QFile::remove(path());
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path()).path());
+
+    QSaveFile file(path());
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << MAGIC << VERSION << static_cast<quint32>(_operations.size());
+    for (const Operation &operation : _operations) {
+        stream << static_cast<quint8>(operation.type) << operation.number;
+    }
+
+    file.commit();
+}
+
+void OperationQueue::onNeedsAuthorizationChanged()
+{
+    if (!_apiClient->getNeedsAuthorization()) return;
+
+    // Changes belong to the account that made them. Answers still on the way find nothing.
+    _operations.clear();
+    _retryTimer.stop();
+    _retryInterval = RETRY_INTERVAL;
+    changed();
+}
+
+QString OperationQueue::path()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/operations.bin";
+}
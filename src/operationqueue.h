@@ -0,0 +1,127 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef OPERATIONQUEUE_H
+#define OPERATIONQUEUE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include "shipmentnumber.h"
+
+class ApiClient;
+class ParcelList;
+
+// Tracking changes, shown in the parcel list at once and sent when the network allows.
+// The queue survives restarts and goes out as one batch, a few requests at a time over
+// the pooled connections, ending with a single refresh. Opposite changes to a parcel
+// that haven't been sent yet cancel out.
+class OperationQueue : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int pending READ getPending NOTIFY pendingChanged)
+    Q_PROPERTY(int concurrency READ getConcurrency WRITE setConcurrency NOTIFY concurrencyChanged)
+public:
+    enum OperationType : quint8 {
+        Track,
+        StopTracking
+    };
+    Q_ENUM(OperationType)
+
+    // Seconds before sending again after a network failure, doubling up to the maximum
+    static const int RETRY_INTERVAL = 30;
+    static const int MAX_RETRY_INTERVAL = 15 * 60;
+    // Requests in flight at once, one below the API request pool so list fetches get through
+    static const int DEFAULT_CONCURRENCY = 3;
+
+    OperationQueue(ApiClient *apiClient, ParcelList *parcelList, QObject *parent = nullptr);
+
+    int getPending() const;
+    int getConcurrency() const;
+    void setConcurrency(int concurrency);
+
+    Q_INVOKABLE void track(QString number);
+    Q_INVOKABLE void stopTracking(QString number);
+    // Tracks every number in pasted text or a CSV, separated by whitespace, commas or
+    // semicolons. Returns the "queued", "alreadyQueued", "cancelled" (undid a queued
+    // stop), "invalid" and "duplicate" numbers, what the server made of the queued ones
+    // comes through succeeded() and failed().
+    Q_INVOKABLE QVariantMap trackAll(const QString &text);
+    Q_INVOKABLE QVariantMap trackFile(const QString &path);
+    static bool isValidNumber(const QString &number);
+    // Sends everything queued that isn't on its way already
+    void flush();
+    // Back online, the failure the retry waits out is over, so everything goes out now
+    void onOnline();
+
+signals:
+    void pendingChanged();
+    void concurrencyChanged();
+    void succeeded(QString number, OperationType type);
+    // The server refused the change, it was dropped
+    void failed(QString number, OperationType type);
+
+private:
+    struct Operation {
+        OperationType type;
+        QString number;
+        bool sending = false;
+        // Failed to go out, waits for the retry
+        bool deferred = false;
+    };
+
+    enum AddResult {
+        Added,
+        AlreadyQueued,
+        // Undid the opposite change that hadn't gone out yet
+        Cancelled
+    };
+
+    void enqueue(OperationType type, const QString &number);
+    AddResult add(OperationType type, const QString &number);
+    void send();
+    void onSent(const QString &number, long statusCode);
+    void onBatchDone();
+    void changed();
+    static bool isTransient(long statusCode);
+    QHash<ShipmentNumber, bool> tracking() const;
+    void read();
+    void write() const;
+    void onNeedsAuthorizationChanged();
+    static QString path();
+
+private:
+    static const quint32 MAGIC = 0x4f50514f;
+    static const quint32 VERSION = 1;
+
+    ApiClient *_apiClient;
+    ParcelList *_parcelList;
+    QVector<Operation> _operations;
+    QTimer _retryTimer;
+    int _retryInterval = RETRY_INTERVAL;
+    int _concurrency = DEFAULT_CONCURRENCY;
+    int _sending = 0;
+    bool _sent = false;
+};
+
+#endif // OPERATIONQUEUE_H
@@ -18,31 +18,96 @@ along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
 
 */
 
+#include <QNetworkConfigurationManager>
 #include <QtQuick>
 #include <sailfishapp.h>
 #include "apiclient.h"
+#include "operationqueue.h"
+#include "parcelfilter.h"
+#include "parcelhistory.h"
 #include "parcellist.h"
+#include "qrcodecache.h"
+#include "qrcodeprovider.h"
+#include "refreshscheduler.h"
+#include "startuptrace.h"
+#include "syncclient.h"
 #include "QZXing.h"
 
 int main(int argc, char *argv[])
 {
+    StartupTrace trace;
+    trace.mark("main");
+
     QScopedPointer<QGuiApplication> app(SailfishApp::application(argc, argv));
+    trace.mark("application");
+    // Outlives the view, whose engine owns the image provider rendering through it
+    QrCodeCache qrCodes;
     QSharedPointer<QQuickView> view(SailfishApp::createView());
+    trace.mark("view");
 
-    QZXing::registerQMLTypes();
-    QZXing::registerQMLImageProvider(*view->engine());
-
+    // Reads the account from the settings, the first page depends on it
     ApiClient client;
+    trace.mark("settings");
+
+    // A running daemon has the lists ready, otherwise the bus starts it for next time
+    // and this process does the work until it is up
+    SyncClient sync;
+    client.setSyncClient(&sync);
+    sync.start();
+    trace.mark("bus");
     ParcelList parcelList(&client);
+    ParcelFilter parcelFilter(&parcelList);
+    RefreshScheduler scheduler(&client, &parcelList);
+    ParcelHistory history(&client);
+    OperationQueue operations(&client, &parcelList);
+    trace.mark("models");
+
+    QObject::connect(&client, &ApiClient::authorized, &sync, &SyncClient::reloadAccount);
+    QObject::connect(&sync, &SyncClient::parcelsChanged, &parcelList, &ParcelList::refresh);
+
+    QObject::connect(app.data(), &QGuiApplication::applicationStateChanged, &scheduler, &RefreshScheduler::setApplicationState);
+
+    // Pre-rendered at the size the QR dialog asks for, the full width of the portrait screen
+    QSize screenSize = app->primaryScreen()->size();
+    QSize qrCodeSize(qMin(screenSize.width(), screenSize.height()), qMin(screenSize.width(), screenSize.height()));
+    view->engine()->addImageProvider("qrcode", new QrCodeProvider(&qrCodes));
+
+    QObject::connect(&parcelList, &ParcelList::pickupQrCodes, &qrCodes, [&qrCodes, qrCodeSize](QStringList codes) {
+        qrCodes.prerender(codes, qrCodeSize);
+    });
+    QObject::connect(&client, &ApiClient::needsAuthorizationChanged, &qrCodes, [&client, &qrCodes]() {
+        if (client.getNeedsAuthorization()) qrCodes.clear();
+    });
 
     view->rootContext()->setContextProperty("api", &client);
     view->rootContext()->setContextProperty("parcelList", &parcelList);
+    view->rootContext()->setContextProperty("parcelFilter", &parcelFilter);
+    view->rootContext()->setContextProperty("operations", &operations);
 
     qmlRegisterType<ParcelList>("com.verdanditeam.outpost", 1, 0, "ParcelList");
 
-
+    // QML compiled ahead of time is in the resources, see OUTPOST_COMPILE_QML
+#ifdef OUTPOST_COMPILED_QML
+    view->setSource(QUrl("qrc:/qml/outpost.qml"));
+#else
     view->setSource(SailfishApp::pathTo("qml/outpost.qml"));
+#endif
+    trace.mark("qml");
     view->show();
 
+    // Nothing on the first page needs these. The bearer plugins behind the network
+    // manager take a while to load.
+    QScopedPointer<QNetworkConfigurationManager> network;
+    trace.watch(view.data(), &parcelList, [&view, &network, &operations]() {
+        QZXing::registerQMLTypes();
+        QZXing::registerQMLImageProvider(*view->engine());
+
+        // Queued tracking changes go out as soon as the device is back online
+        network.reset(new QNetworkConfigurationManager);
+        QObject::connect(network.data(), &QNetworkConfigurationManager::onlineStateChanged, &operations, [&operations](bool online) {
+            if (online) operations.onOnline();
+        });
+    });
+
     return app->exec();
 }
@@ -0,0 +1,58 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDebug>
+#include "apiclient.h"
+#include "parcelhistory.h"
+#include "parcellist.h"
+#include "refreshscheduler.h"
+#include "syncservice.h"
+
+// Keeps the parcel lists synced in the background and serves them to the application
+// and its cover over the session bus, started by the bus on first use
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // The name SailfishApp gives the application, so both share settings and data
+    app.setApplicationName("outpost");
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        qWarning() << "No session bus:" << bus.lastError().message();
+        return 1;
+    }
+
+    ApiClient client;
+    ParcelList parcelList(&client);
+    RefreshScheduler scheduler(&client, &parcelList);
+    ParcelHistory history(&client);
+    SyncService service(&client);
+
+    // Another instance already serves the bus
+    if (!service.registerOn(bus)) {
+        qWarning() << "Can't register" << SyncService::SERVICE << bus.lastError().message();
+        return 1;
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,465 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QTimer>
+#include <algorithm>
+#include "parcelfilter.h"
+#include "parcellist.h"
+
+ParcelFilter::ParcelFilter(ParcelList *parcelList, QObject *parent) : QAbstractProxyModel(parent), _parcelList(parcelList)
+{
+    if (_parcelList == nullptr) return;
+
+    setSourceModel(_parcelList);
+
+    connect(_parcelList, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+    connect(_parcelList, &QAbstractItemModel::modelReset, this, [this]() {
+        rebuild();
+        setRows(query());
+        endResetModel();
+        emit countChanged();
+        fetchAllLater();
+    });
+    connect(_parcelList, &QAbstractItemModel::rowsInserted, this, &ParcelFilter::onRowsInserted);
+    connect(_parcelList, &QAbstractItemModel::rowsRemoved, this, &ParcelFilter::onRowsRemoved);
+    connect(_parcelList, &QAbstractItemModel::rowsMoved, this, &ParcelFilter::onRowsMoved);
+    connect(_parcelList, &QAbstractItemModel::dataChanged, this, &ParcelFilter::onDataChanged);
+
+    rebuild();
+    setRows(query());
+}
+
+QModelIndex ParcelFilter::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= _rows.size()) return QModelIndex();
+
+    return createIndex(row, column);
+}
+
+QModelIndex ParcelFilter::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int ParcelFilter::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _rows.size();
+}
+
+int ParcelFilter::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex ParcelFilter::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || proxyIndex.row() >= _rows.size()) return QModelIndex();
+
+    return _parcelList->index(_rows[proxyIndex.row()]);
+}
+
+QModelIndex ParcelFilter::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid() || sourceIndex.row() >= _proxyRows.size() || _proxyRows[sourceIndex.row()] < 0) return QModelIndex();
+
+    return index(_proxyRows[sourceIndex.row()], 0);
+}
+
+QHash<int, QByteArray> ParcelFilter::roleNames() const
+{
+    return _parcelList != nullptr ? _parcelList->roleNames() : QHash<int, QByteArray>();
+}
+
+QString ParcelFilter::getSearch() const
+{
+    return _search;
+}
+
+void ParcelFilter::setSearch(QString search)
+{
+    if (_search == search) return;
+
+    _search = search;
+    emit searchChanged();
+    apply();
+}
+
+QVariantList ParcelFilter::getStatuses() const
+{
+    return getFilter(StatusDimension);
+}
+
+void ParcelFilter::setStatuses(QVariantList statuses)
+{
+    setFilter(StatusDimension, statuses);
+}
+
+QVariantList ParcelFilter::getSizes() const
+{
+    return getFilter(SizeDimension);
+}
+
+void ParcelFilter::setSizes(QVariantList sizes)
+{
+    setFilter(SizeDimension, sizes);
+}
+
+QVariantList ParcelFilter::getTypes() const
+{
+    return getFilter(TypeDimension);
+}
+
+void ParcelFilter::setTypes(QVariantList types)
+{
+    setFilter(TypeDimension, types);
+}
+
+QVariantList ParcelFilter::getOwnerships() const
+{
+    return getFilter(OwnershipDimension);
+}
+
+void ParcelFilter::setOwnerships(QVariantList ownerships)
+{
+    setFilter(OwnershipDimension, ownerships);
+}
+
+int ParcelFilter::getCount() const
+{
+    return _rows.size();
+}
+
+QVariantList ParcelFilter::getFilter(Dimension dimension) const
+{
+    QVariantList values;
+    for (quint8 value : _filters[dimension]) values.append(value);
+    return values;
+}
+
+void ParcelFilter::setFilter(Dimension dimension, const QVariantList &values)
+{
+    QVector<quint8> filter;
+    for (const QVariant &value : values) filter.append(static_cast<quint8>(value.toUInt()));
+    std::sort(filter.begin(), filter.end());
+
+    if (_filters[dimension] == filter) return;
+
+    _filters[dimension] = filter;
+    emit filtersChanged();
+    apply();
+}
+
+void ParcelFilter::rebuild()
+{
+    const QVector<ParcelList::Parcel> &parcels = _parcelList->getParcels();
+
+    _entries.assign(parcels.size(), Entry());
+    _numbers.clear();
+    _numbers.reserve(parcels.size());
+    _names.clear();
+    for (QVector<QBitArray> &values : _values) {
+        for (QBitArray &rows : values) rows = QBitArray(parcels.size());
+    }
+
+    for (int row = 0; row < parcels.size(); row++) {
+        _numbers.emplace_back(parcels[row].shipmentNumber.toString().toCaseFolded(), row);
+        indexRow(row);
+    }
+
+    std::sort(_numbers.begin(), _numbers.end());
+}
+
+void ParcelFilter::indexRow(int row)
+{
+    const ParcelList::Parcel &parcel = _parcelList->getParcels()[row];
+    Entry &entry = _entries[row];
+
+    entry.name = parcel.senderName.toCaseFolded();
+    entry.values[StatusDimension] = static_cast<quint8>(parcel.status);
+    entry.values[SizeDimension] = static_cast<quint8>(parcel.size);
+    entry.values[TypeDimension] = static_cast<quint8>(parcel.type);
+    entry.values[OwnershipDimension] = static_cast<quint8>(parcel.ownershipStatus);
+
+    if (!entry.name.isEmpty()) {
+        QVector<int> &rows = _names[entry.name];
+        rows.insert(std::lower_bound(rows.begin(), rows.end(), row), row);
+    }
+
+    for (int dimension = 0; dimension < DimensionCount; dimension++) {
+        QVector<QBitArray> &values = _values[dimension];
+        quint8 value = entry.values[dimension];
+        while (values.size() <= value) values.append(QBitArray(static_cast<int>(_entries.size())));
+
+        values[value].setBit(row);
+    }
+}
+
+void ParcelFilter::unindexRow(int row)
+{
+    const Entry &entry = _entries[row];
+
+    auto name = _names.find(entry.name);
+    if (name != _names.end()) {
+        QVector<int> &rows = name.value();
+        auto it = std::lower_bound(rows.begin(), rows.end(), row);
+        if (it != rows.end() && *it == row) rows.erase(it);
+        if (rows.isEmpty()) _names.erase(name);
+    }
+
+    for (int dimension = 0; dimension < DimensionCount; dimension++) {
+        _values[dimension][entry.values[dimension]].clearBit(row);
+    }
+}
+
+void ParcelFilter::remap(int count, const std::function<int(int)> &map)
+{
+    std::vector<Entry> entries(count);
+    for (int row = 0; row < static_cast<int>(_entries.size()); row++) {
+        int to = map(row);
+        if (to >= 0) entries[to] = std::move(_entries[row]);
+    }
+    _entries = std::move(entries);
+
+    // Only rows change, the numbers stay sorted
+    auto number = _numbers.begin();
+    for (const std::pair<QString, int> &entry : _numbers) {
+        int to = map(entry.second);
+        if (to >= 0) *number++ = std::make_pair(entry.first, to);
+    }
+    _numbers.erase(number, _numbers.end());
+
+    for (auto name = _names.begin(); name != _names.end();) {
+        QVector<int> rows;
+        for (int row : name.value()) {
+            int to = map(row);
+            if (to >= 0) rows.append(to);
+        }
+        std::sort(rows.begin(), rows.end());
+
+        if (rows.isEmpty()) {
+            name = _names.erase(name);
+        } else {
+            name.value() = rows;
+            ++name;
+        }
+    }
+
+    for (QVector<QBitArray> &values : _values) {
+        for (QBitArray &rows : values) {
+            QBitArray moved(count);
+            for (int row = 0; row < rows.size(); row++) {
+                if (!rows.testBit(row)) continue;
+                int to = map(row);
+                if (to >= 0) moved.setBit(to);
+            }
+            rows = moved;
+        }
+    }
+}
+
+QVector<int> ParcelFilter::query() const
+{
+    const int count = static_cast<int>(_entries.size());
+    QBitArray matches(count, true);
+
+    for (int dimension = 0; dimension < DimensionCount; dimension++) {
+        if (_filters[dimension].isEmpty()) continue;
+
+        QBitArray any(count);
+        for (quint8 value : _filters[dimension]) {
+            if (value < _values[dimension].size()) any |= _values[dimension][value];
+        }
+        matches &= any;
+    }
+
+    QString search = _search.trimmed().toCaseFolded();
+    if (!search.isEmpty()) {
+        QBitArray found(count);
+
+        auto number = std::lower_bound(_numbers.begin(), _numbers.end(), search, [](const std::pair<QString, int> &entry, const QString &prefix) {
+            return entry.first < prefix;
+        });
+        for (; number != _numbers.end() && number->first.startsWith(search); ++number) found.setBit(number->second);
+
+        // Names are interned, there are far fewer of them than parcels
+        for (auto name = _names.constBegin(); name != _names.constEnd(); ++name) {
+            if (!name.key().contains(search)) continue;
+            for (int row : name.value()) found.setBit(row);
+        }
+
+        matches &= found;
+    }
+
+    QVector<int> rows;
+    for (int row = 0; row < count; row++) {
+        if (matches.testBit(row)) rows.append(row);
+    }
+    return rows;
+}
+
+bool ParcelFilter::isActive() const
+{
+    if (!_search.trimmed().isEmpty()) return true;
+
+    for (const QVector<quint8> &filter : _filters) {
+        if (!filter.isEmpty()) return true;
+    }
+    return false;
+}
+
+void ParcelFilter::apply()
+{
+    if (_parcelList == nullptr) return;
+
+    // Rows of a paged list that aren't loaded yet could match too
+    if (isActive()) _parcelList->fetchAll();
+
+    QVector<int> rows = query();
+    if (rows == _rows) return;
+
+    beginResetModel();
+    setRows(rows);
+    endResetModel();
+    emit countChanged();
+}
+
+void ParcelFilter::setRows(const QVector<int> &rows)
+{
+    _rows = rows;
+    _proxyRows.fill(-1, static_cast<int>(_entries.size()));
+    for (int row = 0; row < _rows.size(); row++) _proxyRows[_rows[row]] = row;
+}
+
+void ParcelFilter::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    static const QVector<int> INDEXED_ROLES = {
+        ParcelList::SenderNameRole, ParcelList::StatusRole, ParcelList::SizeRole, ParcelList::TypeRole, ParcelList::OwnershipRole
+    };
+
+    bool indexed = roles.isEmpty() || std::any_of(roles.begin(), roles.end(), [](int role) {
+        return INDEXED_ROLES.contains(role);
+    });
+
+    if (indexed) {
+        for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+            unindexRow(row);
+            indexRow(row);
+        }
+
+        QVector<int> rows = query();
+        if (rows != _rows) {
+            beginResetModel();
+            setRows(rows);
+            endResetModel();
+            emit countChanged();
+            return;
+        }
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+        QModelIndex index = mapFromSource(_parcelList->index(row));
+        if (index.isValid()) emit dataChanged(index, index, roles);
+    }
+}
+
+void ParcelFilter::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) return;
+
+    const int count = last - first + 1;
+    remap(static_cast<int>(_entries.size()) + count, [first, count](int row) {
+        return row < first ? row : row + count;
+    });
+
+    const QVector<ParcelList::Parcel> &parcels = _parcelList->getParcels();
+    for (int row = first; row <= last; row++) {
+        std::pair<QString, int> number(parcels[row].shipmentNumber.toString().toCaseFolded(), row);
+        _numbers.insert(std::lower_bound(_numbers.begin(), _numbers.end(), number), number);
+        indexRow(row);
+    }
+
+    // Only the new rows can be new matches, they land together in the proxy
+    int proxyFirst = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), first) - _rows.begin());
+    QVector<int> rows = query();
+    int inserted = rows.size() - _rows.size();
+
+    if (inserted > 0) beginInsertRows(QModelIndex(), proxyFirst, proxyFirst + inserted - 1);
+    setRows(rows);
+    if (inserted > 0) {
+        endInsertRows();
+        emit countChanged();
+    }
+
+    fetchAllLater();
+}
+
+void ParcelFilter::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) return;
+
+    int proxyFirst = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), first) - _rows.begin());
+    int proxyEnd = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), last + 1) - _rows.begin());
+
+    const int count = last - first + 1;
+    remap(static_cast<int>(_entries.size()) - count, [first, last, count](int row) {
+        return row < first ? row : row <= last ? -1 : row - count;
+    });
+
+    if (proxyEnd > proxyFirst) beginRemoveRows(QModelIndex(), proxyFirst, proxyEnd - 1);
+    setRows(query());
+    if (proxyEnd > proxyFirst) {
+        endRemoveRows();
+        emit countChanged();
+    }
+}
+
+void ParcelFilter::onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    if (parent.isValid() || destination.isValid()) return;
+
+    // The matching rows of the block stay together, so they move as a block in the proxy too
+    int proxyStart = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), start) - _rows.begin());
+    int proxyEnd = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), end + 1) - _rows.begin());
+    int proxyRow = static_cast<int>(std::lower_bound(_rows.begin(), _rows.end(), row) - _rows.begin());
+
+    const int count = end - start + 1;
+    remap(static_cast<int>(_entries.size()), [start, end, row, count](int source) {
+        if (source >= start && source <= end) return row > end ? row - count + source - start : row + source - start;
+        if (row > end && source > end && source < row) return source - count;
+        if (row < start && source >= row && source < start) return source + count;
+        return source;
+    });
+
+    bool moved = proxyEnd > proxyStart && (proxyRow < proxyStart || proxyRow > proxyEnd);
+    if (moved) beginMoveRows(QModelIndex(), proxyStart, proxyEnd - 1, QModelIndex(), proxyRow);
+    setRows(query());
+    if (moved) endMoveRows();
+}
+
+void ParcelFilter::fetchAllLater()
+{
+    // A refresh can bring back pages, searches look at the whole list
+    if (isActive() && _parcelList->canFetchMore(QModelIndex())) {
+        QTimer::singleShot(0, this, [this]() {
+            if (isActive()) _parcelList->fetchAll();
+        });
+    }
+}
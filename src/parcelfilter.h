@@ -0,0 +1,130 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARCELFILTER_H
+#define PARCELFILTER_H
+
+#include <QAbstractProxyModel>
+#include <QBitArray>
+#include <QHash>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class ParcelList;
+
+// Search and filters over ParcelList answered from indexes instead of a scan: shipment
+// numbers are kept sorted for prefix lookups, names map to the rows carrying them, and
+// each status, size, type and ownership value has a bitmap of its rows. The indexes
+// follow rows that change, come, go and move, which reach the view as the same row
+// changes of the matching rows instead of a reset.
+class ParcelFilter : public QAbstractProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString search READ getSearch WRITE setSearch NOTIFY searchChanged)
+    Q_PROPERTY(QVariantList statuses READ getStatuses WRITE setStatuses NOTIFY filtersChanged)
+    Q_PROPERTY(QVariantList sizes READ getSizes WRITE setSizes NOTIFY filtersChanged)
+    Q_PROPERTY(QVariantList types READ getTypes WRITE setTypes NOTIFY filtersChanged)
+    Q_PROPERTY(QVariantList ownerships READ getOwnerships WRITE setOwnerships NOTIFY filtersChanged)
+    Q_PROPERTY(int count READ getCount NOTIFY countChanged)
+public:
+    explicit ParcelFilter(ParcelList *parcelList = nullptr, QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Shipment number prefix or part of the sender, or receiver, name
+    QString getSearch() const;
+    void setSearch(QString search);
+    // Enum values to keep, everything when empty
+    QVariantList getStatuses() const;
+    void setStatuses(QVariantList statuses);
+    QVariantList getSizes() const;
+    void setSizes(QVariantList sizes);
+    QVariantList getTypes() const;
+    void setTypes(QVariantList types);
+    QVariantList getOwnerships() const;
+    void setOwnerships(QVariantList ownerships);
+    int getCount() const;
+
+signals:
+    void searchChanged();
+    void filtersChanged();
+    void countChanged();
+
+private:
+    enum Dimension {
+        StatusDimension,
+        SizeDimension,
+        TypeDimension,
+        OwnershipDimension,
+        DimensionCount
+    };
+
+    // What the indexes hold for a row, to take it out again when it changes
+    struct Entry {
+        QString name;
+        quint8 values[DimensionCount];
+    };
+
+    void rebuild();
+    void indexRow(int row);
+    void unindexRow(int row);
+    // Moves the index entries to the row the map gives, or drops them for -1
+    void remap(int count, const std::function<int(int)> &map);
+    QVector<int> query() const;
+    bool isActive() const;
+    void apply();
+    void setRows(const QVector<int> &rows);
+    void setFilter(Dimension dimension, const QVariantList &values);
+    QVariantList getFilter(Dimension dimension) const;
+
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row);
+    void fetchAllLater();
+
+private:
+    ParcelList *_parcelList;
+    QString _search;
+    QVector<quint8> _filters[DimensionCount];
+
+    std::vector<Entry> _entries;
+    // Sorted by shipment number
+    std::vector<std::pair<QString, int>> _numbers;
+    // Case folded name to the sorted rows carrying it
+    QHash<QString, QVector<int>> _names;
+    QVector<QBitArray> _values[DimensionCount];
+
+    // Matching source rows in list order, and the reverse mapping
+    QVector<int> _rows;
+    QVector<int> _proxyRows;
+};
+
+#endif // PARCELFILTER_H
@@ -0,0 +1,280 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QMetaEnum>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include "apiclient.h"
+#include "parcelhistory.h"
+#include "parcelparser.h"
+
+static const char *CONNECTION = "history";
+
+ParcelHistory::ParcelHistory(ApiClient *apiClient, QObject *parent) : QObject(parent), _apiClient(apiClient)
+{
+    // One thread that never expires, QSqlDatabase connections belong to their thread
+    _pool.setMaxThreadCount(1);
+    _pool.setExpiryTimeout(-1);
+
+    connect(_apiClient, &ApiClient::parcelsSynced, this, &ParcelHistory::record);
+    connect(_apiClient, &ApiClient::needsAuthorizationChanged, this, [this]() {
+        if (_apiClient->getNeedsAuthorization()) clear();
+    });
+}
+
+ParcelHistory::~ParcelHistory()
+{
+    QtConcurrent::run(&_pool, [this]() {
+        if (!_open) return;
+        QSqlDatabase::database(CONNECTION, false).close();
+        QSqlDatabase::removeDatabase(CONNECTION);
+    });
+    _pool.waitForDone();
+}
+
+void ParcelHistory::record(std::shared_ptr<const ParcelPayload> payload)
+{
+    QVector<Entry> entries;
+
+    // A change in place lists its parcels, anything else is checked in full
+    if (payload->structural) {
+        entries.reserve(payload->parcels.size());
+        for (const ParcelList::Parcel &parcel : payload->parcels) {
+            entries.append({ parcel.shipmentNumber, parcel.senderName, parcel.status });
+        }
+    } else {
+        entries.reserve(payload->changed.size());
+        for (int i : payload->changed) {
+            const ParcelList::Parcel &parcel = payload->parcels[i];
+            entries.append({ parcel.shipmentNumber, parcel.senderName, parcel.status });
+        }
+    }
+
+    if (entries.isEmpty()) return;
+
+    qint64 at = QDateTime::currentMSecsSinceEpoch() / 1000;
+    query<int>([this, entries, at]() {
+        return write(entries, at);
+    }, [this](int transitions) {
+        if (transitions > 0) emit recorded(transitions);
+    });
+}
+
+void ParcelHistory::clear()
+{
+    QtConcurrent::run(&_pool, [this]() {
+        if (!open()) return;
+
+        QSqlDatabase db = QSqlDatabase::database(CONNECTION);
+        db.transaction();
+        QSqlQuery(db).exec("DELETE FROM transitions");
+        QSqlQuery(db).exec("DELETE FROM parcels");
+        db.commit();
+    });
+}
+
+void ParcelHistory::changedSince(qint64 since, ShipmentsHandler handler)
+{
+    query<QStringList>([this, since]() {
+        return shipments("SELECT DISTINCT shipment_number FROM transitions WHERE at >= ?", since);
+    }, handler);
+}
+
+void ParcelHistory::statusDurations(const QString &shipmentNumber, DurationsHandler handler)
+{
+    query<QVariantMap>([this, shipmentNumber]() {
+        QVariantMap durations;
+        if (!open()) return durations;
+
+        QSqlQuery query(QSqlDatabase::database(CONNECTION));
+        query.setForwardOnly(true);
+        query.prepare("SELECT status, at FROM transitions WHERE shipment_number = ? ORDER BY at");
+        query.addBindValue(shipmentNumber);
+        if (!query.exec()) return durations;
+
+        // Each status lasts until the next one, the current one until now
+        QString status;
+        qint64 since = 0;
+        while (query.next()) {
+            qint64 at = query.value(1).toLongLong();
+            if (!status.isEmpty()) durations[status] = durations.value(status).toLongLong() + at - since;
+            status = query.value(0).toString();
+            since = at;
+        }
+        if (!status.isEmpty()) durations[status] = durations.value(status).toLongLong() + QDateTime::currentMSecsSinceEpoch() / 1000 - since;
+
+        return durations;
+    }, handler);
+}
+
+void ParcelHistory::bySender(const QString &senderName, ShipmentsHandler handler)
+{
+    query<QStringList>([this, senderName]() {
+        return shipments("SELECT shipment_number FROM parcels WHERE sender_name = ? ORDER BY since DESC", senderName);
+    }, handler);
+}
+
+bool ParcelHistory::open()
+{
+    if (_open) return true;
+
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION);
+    db.setDatabaseName(directory + "/history.sqlite");
+    // Waits out the other process writing
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        qWarning() << "Can't open parcel history:" << db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA synchronous = NORMAL");
+    query.exec("PRAGMA user_version");
+    int version = query.next() ? query.value(0).toInt() : 0;
+
+    if (version != VERSION) {
+        // Status names are stored rather than enum values, which may be reordered
+        const char *schema[] = {
+            "DROP TABLE IF EXISTS transitions",
+            "DROP TABLE IF EXISTS parcels",
+            "CREATE TABLE transitions (shipment_number TEXT NOT NULL, status TEXT NOT NULL, previous_status TEXT, at INTEGER NOT NULL)",
+            "CREATE INDEX transitions_at ON transitions (at)",
+            "CREATE INDEX transitions_shipment ON transitions (shipment_number, at)",
+            "CREATE TABLE parcels (shipment_number TEXT PRIMARY KEY, sender_name TEXT, status TEXT NOT NULL, since INTEGER NOT NULL) WITHOUT ROWID",
+            "CREATE INDEX parcels_sender ON parcels (sender_name, since)",
+        };
+
+        db.transaction();
+        for (const char *statement : schema) query.exec(statement);
+        query.exec(QString("PRAGMA user_version = %1").arg(VERSION));
+        if (!db.commit()) {
+            qWarning() << "Can't create parcel history:" << db.lastError().text();
+            return false;
+        }
+    }
+
+    _open = true;
+    return true;
+}
+
+int ParcelHistory::write(const QVector<Entry> &entries, qint64 at)
+{
+    if (!open()) return 0;
+
+    QSqlDatabase db = QSqlDatabase::database(CONNECTION);
+    QMetaEnum statuses = QMetaEnum::fromType<ParcelList::ParcelStatus>();
+
+    // The application and the daemon share the file. Taking the write lock up front keeps
+    // the previous statuses read below current until the commit.
+    QSqlQuery begin(db);
+    if (!begin.exec("BEGIN IMMEDIATE")) {
+        qWarning() << "Can't record parcel history:" << begin.lastError().text();
+        return 0;
+    }
+
+    QSqlQuery current(db), transition(db), parcel(db), sender(db);
+    current.prepare("SELECT status, sender_name FROM parcels WHERE shipment_number = ?");
+    transition.prepare("INSERT INTO transitions (shipment_number, status, previous_status, at) VALUES (?, ?, ?, ?)");
+    parcel.prepare("INSERT OR REPLACE INTO parcels (shipment_number, sender_name, status, since) VALUES (?, ?, ?, ?)");
+    sender.prepare("UPDATE parcels SET sender_name = ? WHERE shipment_number = ?");
+
+    int transitions = 0;
+
+    for (const Entry &entry : entries) {
+        QString number = entry.shipmentNumber.toString();
+        QString status = QString::fromLatin1(statuses.valueToKey(static_cast<int>(entry.status)));
+
+        current.addBindValue(number);
+        current.exec();
+        bool known = current.next();
+        QVariant previous = known ? current.value(0) : QVariant(QVariant::String);
+        QString senderName = known ? current.value(1).toString() : QString();
+        current.finish();
+
+        // A sender name can arrive or change without the status moving
+        if (previous.toString() == status) {
+            if (senderName != entry.senderName) {
+                sender.addBindValue(entry.senderName);
+                sender.addBindValue(number);
+                sender.exec();
+            }
+            continue;
+        }
+
+        transition.addBindValue(number);
+        transition.addBindValue(status);
+        transition.addBindValue(previous);
+        transition.addBindValue(at);
+        transition.exec();
+
+        parcel.addBindValue(number);
+        parcel.addBindValue(entry.senderName);
+        parcel.addBindValue(status);
+        parcel.addBindValue(at);
+        parcel.exec();
+
+        transitions++;
+    }
+
+    if (!QSqlQuery(db).exec("COMMIT")) {
+        qWarning() << "Can't record parcel history:" << db.lastError().text();
+        QSqlQuery(db).exec("ROLLBACK");
+        return 0;
+    }
+
+    return transitions;
+}
+
+QStringList ParcelHistory::shipments(const QString &statement, const QVariant &value)
+{
+    QStringList numbers;
+    if (!open()) return numbers;
+
+    QSqlQuery query(QSqlDatabase::database(CONNECTION));
+    query.setForwardOnly(true);
+    query.prepare(statement);
+    query.addBindValue(value);
+    if (!query.exec()) return numbers;
+
+    while (query.next()) numbers.append(query.value(0).toString());
+    return numbers;
+}
+
+template <typename T>
+void ParcelHistory::query(std::function<T()> work, std::function<void(T)> handler)
+{
+    QFutureWatcher<T> *watcher = new QFutureWatcher<T>(this);
+    connect(watcher, &QFutureWatcher<T>::finished, this, [watcher, handler]() {
+        handler(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&_pool, work));
+}
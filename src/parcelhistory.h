@@ -0,0 +1,85 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARCELHISTORY_H
+#define PARCELHISTORY_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariantMap>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "parcellist.h"
+
+class ApiClient;
+struct ParcelPayload;
+
+// Every status a parcel went through and when, in SQLite. Each synced payload is one
+// transaction on a thread of its own, and only parcels whose status moved are written.
+// The daemon and the application may both record, previous statuses come from the file.
+class ParcelHistory : public QObject
+{
+    Q_OBJECT
+    friend class ParcelListBenchmark;
+public:
+    typedef std::function<void(QStringList shipmentNumbers)> ShipmentsHandler;
+    // Seconds spent in each status, by status name
+    typedef std::function<void(QVariantMap durations)> DurationsHandler;
+
+    explicit ParcelHistory(ApiClient *apiClient, QObject *parent = nullptr);
+    ~ParcelHistory();
+
+    void record(std::shared_ptr<const ParcelPayload> payload);
+    void clear();
+
+    // Seconds since epoch
+    void changedSince(qint64 since, ShipmentsHandler handler);
+    void statusDurations(const QString &shipmentNumber, DurationsHandler handler);
+    void bySender(const QString &senderName, ShipmentsHandler handler);
+
+signals:
+    void recorded(int transitions);
+
+private:
+    struct Entry {
+        ShipmentNumber shipmentNumber;
+        QString senderName;
+        ParcelList::ParcelStatus status;
+    };
+
+    // Only called on the pool thread, which owns the connection
+    bool open();
+    int write(const QVector<Entry> &entries, qint64 at);
+    QStringList shipments(const QString &statement, const QVariant &value);
+
+    template <typename T>
+    void query(std::function<T()> work, std::function<void(T)> handler);
+
+private:
+    static const int VERSION = 1;
+
+    ApiClient *_apiClient;
+    QThreadPool _pool;
+    bool _open = false;
+};
+
+#endif // PARCELHISTORY_H
@@ -1,9 +1,164 @@
 #include "parcellist.h"
 #include <QDebug>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <iterator>
+#include <QPointer>
+#include <QSet>
+#include "parcelparser.h"
+
+namespace {
+
+template <typename T>
+struct NamedValue {
+    std::string_view name;
+    T value;
+};
+
+struct StatusInfo {
+    std::string_view name;
+    ParcelList::ParcelStatus value;
+    const char *text;
+    bool pending;
+};
+
+// Sorted by name for binary search, adding an InPost status takes a ParcelStatus value and one line here
+constexpr StatusInfo STATUSES[] = {
+    { "ADOPTED_AT_SORTING_CENTER", ParcelList::ParcelStatus::ADOPTED_AT_SORTING_CENTER, QT_TRANSLATE_NOOP("ParcelList", "Adopted at sorting center"), true },
+    { "ADOPTED_AT_SOURCE_BRANCH", ParcelList::ParcelStatus::ADOPTED_AT_SOURCE_BRANCH, QT_TRANSLATE_NOOP("ParcelList", "Adopted at source branch"), true },
+    { "ADOPTED_AT_TARGET_BRANCH", ParcelList::ParcelStatus::ADOPTED_AT_TARGET_BRANCH, QT_TRANSLATE_NOOP("ParcelList", "Adopted at target branch"), false },
+    { "AVIZO", ParcelList::ParcelStatus::AVIZO, QT_TRANSLATE_NOOP("ParcelList", "Avizo"), false },
+    { "AVIZO_COMPLETED", ParcelList::ParcelStatus::AVIZO_COMPLETED, QT_TRANSLATE_NOOP("ParcelList", "Avizo completed"), false },
+    { "AVIZO_REJECTED", ParcelList::ParcelStatus::AVIZO_REJECTED, QT_TRANSLATE_NOOP("ParcelList", "Avizo rejected"), false },
+    { "C2X_COMPLETED", ParcelList::ParcelStatus::C2X_COMPLETED, QT_TRANSLATE_NOOP("ParcelList", "C2X completed"), false },
+    { "C2X_REJECTED", ParcelList::ParcelStatus::C2X_REJECTED, QT_TRANSLATE_NOOP("ParcelList", "C2X rejected"), false },
+    { "CANCELED", ParcelList::ParcelStatus::CANCELED, QT_TRANSLATE_NOOP("ParcelList", "Cancelled"), false },
+    { "CANCELED_REDIRECT_TO_BOX", ParcelList::ParcelStatus::CANCELED_REDIRECT_TO_BOX, QT_TRANSLATE_NOOP("ParcelList", "Canceled redirect to box"), false },
+    { "CLAIMED", ParcelList::ParcelStatus::CLAIMED, QT_TRANSLATE_NOOP("ParcelList", "Claimed"), false },
+    { "COD_COMPLETED", ParcelList::ParcelStatus::COD_COMPLETED, QT_TRANSLATE_NOOP("ParcelList", "COD completed"), false },
+    { "COD_REJECTED", ParcelList::ParcelStatus::COD_REJECTED, QT_TRANSLATE_NOOP("ParcelList", "COD rejected"), false },
+    { "COLLECTED_FROM_SENDER", ParcelList::ParcelStatus::COLLECTED_FROM_SENDER, QT_TRANSLATE_NOOP("ParcelList", "Collected from sender"), true },
+    { "CONFIRMED", ParcelList::ParcelStatus::CONFIRMED, QT_TRANSLATE_NOOP("ParcelList", "Confirmed"), true },
+    { "CREATED", ParcelList::ParcelStatus::CREATED, QT_TRANSLATE_NOOP("ParcelList", "Created"), false },
+    { "DELAY_IN_DELIVERY", ParcelList::ParcelStatus::DELAY_IN_DELIVERY, QT_TRANSLATE_NOOP("ParcelList", "Delay in delivery"), false },
+    { "DELIVERED", ParcelList::ParcelStatus::DELIVERED, QT_TRANSLATE_NOOP("ParcelList", "Delivered"), false },
+    { "DISPATCHED_BY_SENDER", ParcelList::ParcelStatus::DISPATCHED_BY_SENDER, QT_TRANSLATE_NOOP("ParcelList", "Dispatched by sender"), true },
+    { "DISPATCHED_BY_SENDER_TO_POK", ParcelList::ParcelStatus::DISPATCHED_BY_SENDER_TO_POK, QT_TRANSLATE_NOOP("ParcelList", "Dispatched by sender to POK"), true },
+    { "MISSING", ParcelList::ParcelStatus::MISSING, QT_TRANSLATE_NOOP("ParcelList", "Missing"), false },
+    { "OFFERS_PREPARED", ParcelList::ParcelStatus::OFFERS_PREPARED, QT_TRANSLATE_NOOP("ParcelList", "Offers prepared"), false },
+    { "OFFER_SELECTED", ParcelList::ParcelStatus::OFFER_SELECTED, QT_TRANSLATE_NOOP("ParcelList", "Offer selected"), false },
+    { "OUT_FOR_DELIVERY", ParcelList::ParcelStatus::OUT_FOR_DELIVERY, QT_TRANSLATE_NOOP("ParcelList", "Out for delivery"), true },
+    { "OUT_FOR_DELIVERY_TO_ADDRESS", ParcelList::ParcelStatus::OUT_FOR_DELIVERY_TO_ADDRESS, QT_TRANSLATE_NOOP("ParcelList", "Out for delivery to address"), true },
+    { "OVERSIZED", ParcelList::ParcelStatus::OVERSIZED, QT_TRANSLATE_NOOP("ParcelList", "Oversized"), false },
+    { "PICKUP_REMINDER_SENT", ParcelList::ParcelStatus::PICKUP_REMINDER_SENT, QT_TRANSLATE_NOOP("ParcelList", "Pickup reminder sent"), false },
+    { "PICKUP_REMINDER_SENT_ADDRESS", ParcelList::ParcelStatus::PICKUP_REMINDER_SENT_ADDRESS, QT_TRANSLATE_NOOP("ParcelList", "Pickup reminder sent address"), false },
+    { "PICKUP_TIME_EXPIRED", ParcelList::ParcelStatus::PICKUP_TIME_EXPIRED, QT_TRANSLATE_NOOP("ParcelList", "Pickup time expired"), false },
+    { "READDRESSED", ParcelList::ParcelStatus::READDRESSED, QT_TRANSLATE_NOOP("ParcelList", "Re-addressed"), false },
+    { "READY_TO_PICKUP", ParcelList::ParcelStatus::READY_TO_PICKUP, QT_TRANSLATE_NOOP("ParcelList", "Ready to pickup"), true },
+    { "READY_TO_PICKUP_FROM_BRANCH", ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_BRANCH, QT_TRANSLATE_NOOP("ParcelList", "Ready to pickup from branch"), false },
+    { "READY_TO_PICKUP_FROM_POK", ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_POK, QT_TRANSLATE_NOOP("ParcelList", "Ready to pickup from POK"), false },
+    { "READY_TO_PICKUP_FROM_POK_REGISTERED", ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_POK_REGISTERED, QT_TRANSLATE_NOOP("ParcelList", "Ready to pickup from POK registered"), false },
+    { "REDIRECT_TO_BOX", ParcelList::ParcelStatus::REDIRECT_TO_BOX, QT_TRANSLATE_NOOP("ParcelList", "Redirect to box"), false },
+    { "REJECTED_BY_RECEIVER", ParcelList::ParcelStatus::REJECTED_BY_RECEIVER, QT_TRANSLATE_NOOP("ParcelList", "Rejected by receiver"), false },
+    { "RETURNED_TO_SENDER", ParcelList::ParcelStatus::RETURNED_TO_SENDER, QT_TRANSLATE_NOOP("ParcelList", "Returned to sender"), false },
+    { "RETURN_PICKUP_CONFIRMATION_TO_SENDER", ParcelList::ParcelStatus::RETURN_PICKUP_CONFIRMATION_TO_SENDER, QT_TRANSLATE_NOOP("ParcelList", "Return pickup confirmation to sender"), false },
+    { "SENT_FROM_SORTING_CENTER", ParcelList::ParcelStatus::SENT_FROM_SORTING_CENTER, QT_TRANSLATE_NOOP("ParcelList", "Sent from sorting center"), false },
+    { "SENT_FROM_SOURCE_BRANCH", ParcelList::ParcelStatus::SENT_FROM_SOURCE_BRANCH, QT_TRANSLATE_NOOP("ParcelList", "Sent from source branch"), true },
+    { "STACK_IN_BOX_MACHINE", ParcelList::ParcelStatus::STACK_IN_BOX_MACHINE, QT_TRANSLATE_NOOP("ParcelList", "Stack in box machine"), true },
+    { "STACK_IN_CUSTOMER_SERVICE_POINT", ParcelList::ParcelStatus::STACK_IN_CUSTOMER_SERVICE_POINT, QT_TRANSLATE_NOOP("ParcelList", "Stack in customer service point"), true },
+    { "STACK_PARCEL_IN_BOX_MACHINE_PICKUP_TIME_EXPIRED", ParcelList::ParcelStatus::STACK_PARCEL_IN_BOX_MACHINE_PICKUP_TIME_EXPIRED, QT_TRANSLATE_NOOP("ParcelList", "Stack parcel in box machine pickup time expired"), false },
+    { "STACK_PARCEL_PICKUP_TIME_EXPIRED", ParcelList::ParcelStatus::STACK_PARCEL_PICKUP_TIME_EXPIRED, QT_TRANSLATE_NOOP("ParcelList", "Stack parcel pickup time expired"), false },
+    { "TAKEN_BY_COURIER", ParcelList::ParcelStatus::TAKEN_BY_COURIER, QT_TRANSLATE_NOOP("ParcelList", "Taken by courier"), true },
+    { "TAKEN_BY_COURIER_FROM_POK", ParcelList::ParcelStatus::TAKEN_BY_COURIER_FROM_POK, QT_TRANSLATE_NOOP("ParcelList", "Taken by courier from POK"), true },
+    { "UNDELIVERED", ParcelList::ParcelStatus::UNDELIVERED, QT_TRANSLATE_NOOP("ParcelList", "Undelivered"), false },
+    { "UNDELIVERED_COD_CASH_RECEIVER", ParcelList::ParcelStatus::UNDELIVERED_COD_CASH_RECEIVER, QT_TRANSLATE_NOOP("ParcelList", "Undelivered cod cash receiver"), false },
+    { "UNDELIVERED_INCOMPLETE_ADDRESS", ParcelList::ParcelStatus::UNDELIVERED_INCOMPLETE_ADDRESS, QT_TRANSLATE_NOOP("ParcelList", "Undelivered incomplete address"), false },
+    { "UNDELIVERED_LACK_OF_ACCESS_LETTERBOX", ParcelList::ParcelStatus::UNDELIVERED_LACK_OF_ACCESS_LETTERBOX, QT_TRANSLATE_NOOP("ParcelList", "Undelivered lack of access letterbox"), false },
+    { "UNDELIVERED_NOT_LIVE_ADDRESS", ParcelList::ParcelStatus::UNDELIVERED_NOT_LIVE_ADDRESS, QT_TRANSLATE_NOOP("ParcelList", "Undelivered not live address"), false },
+    { "UNDELIVERED_NO_MAILBOX", ParcelList::ParcelStatus::UNDELIVERED_NO_MAILBOX, QT_TRANSLATE_NOOP("ParcelList", "Undelivered no mailbox"), false },
+    { "UNDELIVERED_UNKNOWN_RECEIVER", ParcelList::ParcelStatus::UNDELIVERED_UNKNOWN_RECEIVER, QT_TRANSLATE_NOOP("ParcelList", "Undelivered unknown receiver"), false },
+    { "UNDELIVERED_WRONG_ADDRESS", ParcelList::ParcelStatus::UNDELIVERED_WRONG_ADDRESS, QT_TRANSLATE_NOOP("ParcelList", "Undelivered wrong address"), false },
+    { "UNSTACK_FROM_BOX_MACHINE", ParcelList::ParcelStatus::UNSTACK_FROM_BOX_MACHINE, QT_TRANSLATE_NOOP("ParcelList", "Unstack from box macine"), false },
+    { "UNSTACK_FROM_CUSTOMER_SERVICE_POINT", ParcelList::ParcelStatus::UNSTACK_FROM_CUSTOMER_SERVICE_POINT, QT_TRANSLATE_NOOP("ParcelList", "Unstack from customer service point"), false },
+};
+
+constexpr NamedValue<ParcelList::ParcelSize> SIZES[] = {
+    { "A", ParcelList::ParcelSize::A },
+    { "B", ParcelList::ParcelSize::B },
+    { "C", ParcelList::ParcelSize::C },
+};
+
+constexpr NamedValue<ParcelList::ParcelOwnershipStatus> OWNERSHIP_STATUSES[] = {
+    { "FRIEND", ParcelList::ParcelOwnershipStatus::FRIEND },
+    { "OBSERVED", ParcelList::ParcelOwnershipStatus::OBSERVED },
+    { "OWN", ParcelList::ParcelOwnershipStatus::OWN },
+};
+
+constexpr NamedValue<ParcelList::ParcelType> TYPES[] = {
+    { "courier", ParcelList::ParcelType::COURIER },
+    { "parcel", ParcelList::ParcelType::PARCEL },
+};
+
+template <typename Entry>
+constexpr bool sortedByName(const Entry &a, const Entry &b)
+{
+    return a.name < b.name;
+}
+
+static_assert(std::is_sorted(std::begin(STATUSES), std::end(STATUSES), sortedByName<StatusInfo>), "STATUSES must be sorted by name");
+static_assert(std::is_sorted(std::begin(SIZES), std::end(SIZES), sortedByName<NamedValue<ParcelList::ParcelSize>>), "SIZES must be sorted by name");
+static_assert(std::is_sorted(std::begin(OWNERSHIP_STATUSES), std::end(OWNERSHIP_STATUSES), sortedByName<NamedValue<ParcelList::ParcelOwnershipStatus>>), "OWNERSHIP_STATUSES must be sorted by name");
+static_assert(std::is_sorted(std::begin(TYPES), std::end(TYPES), sortedByName<NamedValue<ParcelList::ParcelType>>), "TYPES must be sorted by name");
+
+constexpr std::size_t STATUS_COUNT = [] {
+    std::size_t count = static_cast<std::size_t>(ParcelList::ParcelStatus::OTHER) + 1;
+    for (const StatusInfo &info : STATUSES) count = std::max(count, static_cast<std::size_t>(info.value) + 1);
+    return count;
+}();
+static_assert(STATUS_COUNT <= 64, "PENDING_STATUSES is built from a 64 bit mask");
+const std::size_t ParcelList::STATUS_COUNT = ::STATUS_COUNT;
+
+constexpr std::array<const char *, STATUS_COUNT> STATUS_TEXTS = [] {
+    std::array<const char *, STATUS_COUNT> texts{};
+    for (const StatusInfo &info : STATUSES) texts[static_cast<std::size_t>(info.value)] = info.text;
+    return texts;
+}();
+
+constexpr std::bitset<STATUS_COUNT> PENDING_STATUSES = [] {
+    unsigned long long mask = 0;
+    for (const StatusInfo &info : STATUSES) {
+        if (info.pending) mask |= 1ULL << static_cast<std::size_t>(info.value);
+    }
+    return std::bitset<STATUS_COUNT>(mask);
+}();
+
+template <typename Entry, std::size_t N>
+const Entry *lookup(const Entry (&table)[N], std::string_view name)
+{
+    const Entry *entry = std::lower_bound(std::begin(table), std::end(table), name, [](const Entry &candidate, std::string_view value) {
+        return candidate.name < value;
+    });
+    return entry != std::end(table) && entry->name == name ? entry : nullptr;
+}
+
+}
 
 ParcelList::ParcelList(ApiClient *apiClient, QObject *parent) : QAbstractListModel(parent)
 {
     _apiClient = apiClient;
+
+    translateTexts();
+
+    if (_apiClient != nullptr) {
+        connect(_apiClient, &ApiClient::needsAuthorizationChanged, this, &ParcelList::onNeedsAuthorizationChanged);
+        connect(_apiClient, &ApiClient::authorized, this, &ParcelList::prefetch);
+
+        if (!_apiClient->getNeedsAuthorization()) {
+            showSnapshot(_listType);
+            prefetch();
+        }
+    }
 }
 
 int ParcelList::rowCount(const QModelIndex &parent) const
@@ -22,19 +177,19 @@ QVariant ParcelList::data(const QModelIndex &index, int role) const
     case ParcelRoles::IdRole:
         return index.row();
     case ParcelRoles::ShipmentNumberRole:
-        return parcel.shipmentNumber;
+        return parcel.shipmentNumber.toString();
     case ParcelRoles::SenderNameRole:
         return parcel.senderName;
     case ParcelRoles::OpenCodeRole:
         return parcel.openCode;
     case ParcelRoles::SizeRole:
-        return translateParcelSize(parcel.size);
+        return _sizeTexts[static_cast<int>(parcel.size)];
     case ParcelRoles::QrCodeRole:
         return parcel.qrCode;
     case ParcelRoles::StatusRole:
-        return translateParcelStatus(parcel.status);
+        return _statusTexts[static_cast<int>(parcel.status)];
     case ParcelRoles::TypeRole:
-        return translateParcelType(parcel.type);
+        return _typeTexts[static_cast<int>(parcel.type)];
     case ParcelRoles::OwnershipRole:
         return static_cast<unsigned int>(parcel.ownershipStatus);
     default:
@@ -42,6 +197,30 @@ QVariant ParcelList::data(const QModelIndex &index, int role) const
     }
 }
 
+void ParcelList::retranslate()
+{
+    translateTexts();
+    if (!_parcels.isEmpty()) emit dataChanged(index(0), index(_parcels.size() - 1), { SizeRole, StatusRole, TypeRole });
+}
+
+void ParcelList::translateTexts()
+{
+    _statusTexts.resize(STATUS_COUNT);
+    for (std::size_t status = 0; status < STATUS_COUNT; status++) {
+        _statusTexts[status] = translateParcelStatus(static_cast<ParcelStatus>(status));
+    }
+
+    _sizeTexts.resize(static_cast<int>(ParcelSize::OTHER) + 1);
+    for (int size = 0; size < _sizeTexts.size(); size++) {
+        _sizeTexts[size] = translateParcelSize(static_cast<ParcelSize>(size));
+    }
+
+    _typeTexts.resize(static_cast<int>(ParcelType::OTHER) + 1);
+    for (int type = 0; type < _typeTexts.size(); type++) {
+        _typeTexts[type] = translateParcelType(static_cast<ParcelType>(type));
+    }
+}
+
 QHash<int, QByteArray> ParcelList::roleNames() const
 {
     QHash<int, QByteArray> roles;
@@ -66,326 +245,407 @@ void ParcelList::load(unsigned int listTypeIndex)
 
 void ParcelList::load(ApiClient::ParcelListType listType)
 {
-    _listType = listType;
+    if (listType != _listType) {
+        _listType = listType;
+        showSnapshot(listType);
+    }
+
+    fetch(false);
+}
+
+void ParcelList::reload()
+{
+    fetch(true);
+}
+
+void ParcelList::refresh()
+{
+    fetch(false);
+}
+
+void ParcelList::fetch(bool force)
+{
+    ApiClient::ParcelListType listType = _listType;
+
+    // Responses for lists that are no longer selected are dropped
+    unsigned int generation = ++_loadGeneration;
+    QPointer<ParcelList> self(this);
+
+    setLoading(true);
+    _apiClient->getParcels(listType, [self, generation, listType](std::shared_ptr<const ParcelPayload> data, quint64 revision) {
+        if (!self || generation != self->_loadGeneration) return;
+
+        self->setLoading(false);
+
+        // Pending and Tracked share a payload, only filter it again when it is new to this list
+        if (data && self->_revisions.value(listType) != revision) {
+            QVector<Parcel> changed;
+            if (!self->patch(*data, changed)) {
+                self->populate(*data);
+                changed = self->allParcels();
+            }
+            self->setList(listType, self->allParcels(), data->compartments);
+            self->announcePickupQrCodes(changed);
+            self->_revisions[listType] = revision;
+        }
+
+        emit self->refreshed();
+    }, force);
+}
+
+void ParcelList::prefetch()
+{
+    QPointer<ParcelList> self(this);
+
+    // Requests run in parallel on the API request pool, Pending and Tracked share one
+    for (int type = ApiClient::Pending; type <= ApiClient::Returns; type++) {
+        ApiClient::ParcelListType listType = static_cast<ApiClient::ParcelListType>(type);
+        if (listType == _listType) continue;
+
+        _apiClient->getParcels(listType, [self, listType](std::shared_ptr<const ParcelPayload> data, quint64 revision) {
+            // The selected list is updated by fetch(), which shares this request
+            if (!self || !data || listType == self->_listType || self->_revisions.value(listType) == revision) return;
+
+            QVector<Parcel> parcels = filter(listType, *data);
+            self->setList(listType, parcels, data->compartments);
+            self->announcePickupQrCodes(parcels);
+            self->_revisions[listType] = revision;
+        });
+    }
+}
+
+void ParcelList::setTracking(const QHash<ShipmentNumber, bool> &tracking)
+{
+    // Dropped changes leave rows the next fetch has to put right, even with nothing new
+    for (auto it = _tracking.constBegin(); it != _tracking.constEnd(); ++it) {
+        if (!tracking.contains(it.key())) {
+            _revisions.remove(ApiClient::Pending);
+            _revisions.remove(ApiClient::Tracked);
+            break;
+        }
+    }
+
+    _tracking = tracking;
+    if (_listType == ApiClient::Pending || _listType == ApiClient::Tracked) update(allParcels());
+}
+
+bool ParcelList::getLoading() const
+{
+    return _loading;
+}
+
+const QVector<ParcelList::Parcel> &ParcelList::getParcels() const
+{
+    return _parcels;
+}
+
+void ParcelList::setLoading(bool loading)
+{
+    if (_loading == loading) return;
+
+    _loading = loading;
+    emit loadingChanged();
+}
+
+void ParcelList::showSnapshot(ApiClient::ParcelListType listType)
+{
+    // Without the list in memory it shows empty until the store is read, not the previous list's rows
+    showList(listType, _lists.value(listType));
+    if (_lists.contains(listType) || _apiClient == nullptr) return;
+
+    QPointer<ParcelList> self(this);
+    _apiClient->getStoredParcels(listType, [self, listType](std::shared_ptr<const ParcelPayload> data, quint64 revision) {
+        // The fetch got there first, or the account is gone
+        if (!self || !data || self->_lists.contains(listType) || self->_apiClient->getNeedsAuthorization()) return;
 
-    nlohmann::json data = _apiClient->getParcels(_listType);
-    auto parcels = data["parcels"];
+        QVector<Parcel> parcels = filter(listType, *data);
+        self->setList(listType, parcels, data->compartments);
+        self->_revisions[listType] = revision;
+        if (listType == self->_listType) self->showList(listType, parcels);
+    });
+}
+
+void ParcelList::showList(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels)
+{
+    QVector<Parcel> shown = overlay(listType, parcels);
+    int count = shownCount(listType, shown.size(), 0);
+
+    _positions.clear();
+    beginResetModel();
+    _parcels = shown.mid(0, count);
+    _more = shown.mid(count);
+    endResetModel();
+
+    announcePickupQrCodes(shown);
+}
+
+void ParcelList::setList(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels, const QVector<ShipmentNumber> &compartments)
+{
+    _lists[listType] = parcels;
+    _compartments[listType] = compartments;
+}
+
+void ParcelList::announcePickupQrCodes(const QVector<Parcel> &parcels)
+{
+    QStringList qrCodes;
+    for (const Parcel &parcel : parcels) {
+        if (parcel.status == ParcelStatus::READY_TO_PICKUP && !parcel.qrCode.isEmpty()) qrCodes.append(parcel.qrCode);
+    }
+
+    if (!qrCodes.isEmpty()) emit pickupQrCodes(qrCodes);
+}
+
+void ParcelList::onNeedsAuthorizationChanged()
+{
+    if (!_apiClient->getNeedsAuthorization()) return;
+
+    _lists.clear();
+    _compartments.clear();
+    _revisions.clear();
+    _positions.clear();
 
     beginResetModel();
     _parcels.clear();
-    for (auto parcel : parcels) {
-        Parcel newParcel{
-            .shipmentNumber = QString::fromStdString(parcel["shipmentNumber"]),
-            .openCode = QString::fromStdString(parcel.value("openCode", "")),
-            .ownershipStatus = parseOwnershipStatus(parcel.value("ownershipStatus", "")),
-            .size = parseParcelSize(parcel.value("parcelSize", "")),
-            .qrCode = QString::fromStdString(parcel.value("qrCode", "")),
-            .status = parseParcelStatus(parcel.value("status", "")),
-            .type = parseParcelType(parcel.value("shipmentType", ""))
-        };
-
-        if (_listType == ApiClient::ParcelListType::Sent) {
-            if (parcel.contains("receiver")) {
-                newParcel.senderName = QString::fromStdString(parcel["receiver"].value("name", ""));
-            }
+    _more.clear();
+    endResetModel();
+}
+
+void ParcelList::populate(const ParcelPayload &payload)
+{
+    update(filter(_listType, payload));
+}
+
+bool ParcelList::patch(const ParcelPayload &payload, QVector<Parcel> &changed)
+{
+    // Only parcels changed in place on top of the revision shown can be patched
+    if (payload.structural || payload.baseRevision != _revisions.value(_listType)) return false;
+
+    if (_positions.isEmpty()) {
+        int position = 0;
+        for (const Parcel &parcel : _parcels) _positions.insert(parcel.shipmentNumber, position++);
+        for (const Parcel &parcel : _more) _positions.insert(parcel.shipmentNumber, position++);
+    }
+
+    // Check everything first, a parcel entering or leaving Pending means a full update
+    QVector<QPair<int, int>> patches;
+    for (int i : payload.changed) {
+        const Parcel &parcel = payload.parcels[i];
+        int position = _positions.value(parcel.shipmentNumber, -1);
+        bool listed = _listType != ApiClient::Pending || isPending(parcel.status);
+
+        if (listed != (position >= 0)) return false;
+        if (listed) patches.append(qMakePair(position, i));
+    }
+
+    for (const QPair<int, int> &patch : patches) {
+        const Parcel &parcel = payload.parcels[patch.second];
+        int row = patch.first;
+
+        if (row < _parcels.size()) {
+            QVector<int> roles = changedRoles(_parcels[row], parcel);
+            _parcels[row] = parcel;
+            if (!roles.isEmpty()) emit dataChanged(index(row), index(row), roles);
         } else {
-            if (parcel.contains("sender")) {
-                newParcel.senderName = QString::fromStdString(parcel["sender"].value("name", ""));
-            }
+            _more[row - _parcels.size()] = parcel;
         }
+        changed.append(parcel);
+    }
+
+    return true;
+}
+
+QVector<ParcelList::Parcel> ParcelList::filter(ApiClient::ParcelListType listType, const ParcelPayload &payload)
+{
+    if (listType != ApiClient::Pending) return payload.parcels;
 
-        if (_listType == ApiClient::Pending && !_pendingStatuses.contains(newParcel.status)) continue;
+    QVector<Parcel> parcels;
+    parcels.reserve(payload.parcels.size());
+    for (const Parcel &parcel : payload.parcels) {
+        if (isPending(parcel.status)) parcels.append(parcel);
+    }
 
-        if (parcel.contains("multiCompartment")) {
-            if (parcel["multiCompartment"].contains("shipmentNumbers")) {
-                QString shipmentNumbers;
+    return parcels;
+}
 
-                for (nlohmann::json number : parcel["multiCompartment"]["shipmentNumbers"]) {
-                    shipmentNumbers += QString::fromStdString(number) + ",";
-                }
+void ParcelList::update(const QVector<Parcel> &list)
+{
+    QVector<Parcel> parcels = overlay(_listType, list);
 
-                shipmentNumbers = shipmentNumbers.left(shipmentNumbers.length()-1);
+    _positions.clear();
+    int shown = shownCount(_listType, parcels.size(), _parcels.size());
+    _more = parcels.mid(shown);
+    diff(shown == parcels.size() ? parcels : parcels.mid(0, shown));
+}
 
-                newParcel.multiCompartment = shipmentNumbers;
-                newParcel.type = ParcelType::MULTICOMPARTMENT;
-            } else {
-                continue;
-            }
+QVector<ParcelList::Parcel> ParcelList::overlay(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels) const
+{
+    if (_tracking.isEmpty() || (listType != ApiClient::Pending && listType != ApiClient::Tracked)) return parcels;
+
+    // Parcels no longer tracked go at once, new ones lead the list until the server has them
+    QVector<Parcel> result;
+    QSet<ShipmentNumber> listed;
+    for (const Parcel &parcel : parcels) {
+        if (!_tracking.value(parcel.shipmentNumber, true)) continue;
+        result.append(parcel);
+        listed.insert(parcel.shipmentNumber);
+    }
+
+    if (listType == ApiClient::Tracked) {
+        for (auto it = _tracking.constBegin(); it != _tracking.constEnd(); ++it) {
+            if (!it.value() || listed.contains(it.key())) continue;
+
+            Parcel parcel;
+            parcel.shipmentNumber = it.key();
+            parcel.ownershipStatus = ParcelOwnershipStatus::OBSERVED;
+            result.prepend(parcel);
         }
-        _parcels.push_front(newParcel);
     }
 
-    endResetModel();
+    return result;
 }
 
-ParcelList::ParcelStatus ParcelList::parseParcelStatus(std::string parcelStatus)
-{
-    if (parcelStatus == "CREATED")
-        return ParcelStatus::CREATED;
-    if (parcelStatus == "ADOPTED_AT_SORTING_CENTER")
-        return ParcelStatus::ADOPTED_AT_SORTING_CENTER;
-    if (parcelStatus == "ADOPTED_AT_SOURCE_BRANCH")
-        return ParcelStatus::ADOPTED_AT_SOURCE_BRANCH;
-    if (parcelStatus == "ADOPTED_AT_TARGET_BRANCH")
-        return ParcelStatus::ADOPTED_AT_TARGET_BRANCH;
-    if (parcelStatus == "AVIZO")
-        return ParcelStatus::AVIZO;
-    if (parcelStatus == "CANCELED")
-        return ParcelStatus::CANCELED;
-    if (parcelStatus == "CANCELED_REDIRECT_TO_BOX")
-        return ParcelStatus::CANCELED_REDIRECT_TO_BOX;
-    if (parcelStatus == "CLAIMED")
-        return ParcelStatus::CLAIMED;
-    if (parcelStatus == "COLLECTED_FROM_SENDER")
-        return ParcelStatus::COLLECTED_FROM_SENDER;
-    if (parcelStatus == "CONFIRMED")
-        return ParcelStatus::CONFIRMED;
-    if (parcelStatus == "DELAY_IN_DELIVERY")
-        return ParcelStatus::DELAY_IN_DELIVERY;
-    if (parcelStatus == "DELIVERED")
-        return ParcelStatus::DELIVERED;
-    if (parcelStatus == "DISPATCHED_BY_SENDER")
-        return ParcelStatus::DISPATCHED_BY_SENDER;
-    if (parcelStatus == "DISPATCHED_BY_SENDER_TO_POK")
-        return ParcelStatus::DISPATCHED_BY_SENDER_TO_POK;
-    if (parcelStatus == "MISSING")
-        return ParcelStatus::MISSING;
-    if (parcelStatus == "OFFER_SELECTED")
-        return ParcelStatus::OFFER_SELECTED;
-    if (parcelStatus == "OFFERS_PREPARED")
-        return ParcelStatus::OFFERS_PREPARED;
-    if (parcelStatus == "OUT_FOR_DELIVERY")
-        return ParcelStatus::OUT_FOR_DELIVERY;
-    if (parcelStatus == "OUT_FOR_DELIVERY_TO_ADDRESS")
-        return ParcelStatus::OUT_FOR_DELIVERY_TO_ADDRESS;
-    if (parcelStatus == "OVERSIZED")
-        return ParcelStatus::OVERSIZED;
-    if (parcelStatus == "PICKUP_REMINDER_SENT_ADDRESS")
-        return ParcelStatus::PICKUP_REMINDER_SENT_ADDRESS;
-    if (parcelStatus == "PICKUP_REMINDER_SENT")
-        return ParcelStatus::PICKUP_REMINDER_SENT;
-    if (parcelStatus == "PICKUP_TIME_EXPIRED")
-        return ParcelStatus::PICKUP_TIME_EXPIRED;
-    if (parcelStatus == "READDRESSED")
-        return ParcelStatus::READDRESSED;
-    if (parcelStatus == "READY_TO_PICKUP")
-        return ParcelStatus::READY_TO_PICKUP;
-    if (parcelStatus == "READY_TO_PICKUP_FROM_BRANCH")
-        return ParcelStatus::READY_TO_PICKUP_FROM_BRANCH;
-    if (parcelStatus == "READY_TO_PICKUP_FROM_POK")
-        return ParcelStatus::READY_TO_PICKUP_FROM_POK;
-    if (parcelStatus == "READY_TO_PICKUP_FROM_POK_REGISTERED")
-        return ParcelStatus::READY_TO_PICKUP_FROM_POK_REGISTERED;
-    if (parcelStatus == "REDIRECT_TO_BOX")
-        return ParcelStatus::REDIRECT_TO_BOX;
-    if (parcelStatus == "REJECTED_BY_RECEIVER")
-        return ParcelStatus::REJECTED_BY_RECEIVER;
-    if (parcelStatus == "RETURNED_TO_SENDER")
-        return ParcelStatus::RETURNED_TO_SENDER;
-    if (parcelStatus == "RETURN_PICKUP_CONFIRMATION_TO_SENDER")
-        return ParcelStatus::RETURN_PICKUP_CONFIRMATION_TO_SENDER;
-    if (parcelStatus == "SENT_FROM_SORTING_CENTER")
-        return ParcelStatus::SENT_FROM_SORTING_CENTER;
-    if (parcelStatus == "SENT_FROM_SOURCE_BRANCH")
-        return ParcelStatus::SENT_FROM_SOURCE_BRANCH;
-    if (parcelStatus == "STACK_IN_BOX_MACHINE")
-        return ParcelStatus::STACK_IN_BOX_MACHINE;
-    if (parcelStatus == "STACK_IN_CUSTOMER_SERVICE_POINT")
-        return ParcelStatus::STACK_IN_CUSTOMER_SERVICE_POINT;
-    if (parcelStatus == "STACK_PARCEL_PICKUP_TIME_EXPIRED")
-        return ParcelStatus::STACK_PARCEL_PICKUP_TIME_EXPIRED;
-    if (parcelStatus == "STACK_PARCEL_IN_BOX_MACHINE_PICKUP_TIME_EXPIRED")
-        return ParcelStatus::STACK_PARCEL_IN_BOX_MACHINE_PICKUP_TIME_EXPIRED;
-    if (parcelStatus == "TAKEN_BY_COURIER")
-        return ParcelStatus::TAKEN_BY_COURIER;
-    if (parcelStatus == "TAKEN_BY_COURIER_FROM_POK")
-        return ParcelStatus::TAKEN_BY_COURIER_FROM_POK;
-    if (parcelStatus == "UNDELIVERED")
-        return ParcelStatus::UNDELIVERED;
-    if (parcelStatus == "UNDELIVERED_COD_CASH_RECEIVER")
-        return ParcelStatus::UNDELIVERED_COD_CASH_RECEIVER;
-    if (parcelStatus == "UNDELIVERED_INCOMPLETE_ADDRESS")
-        return ParcelStatus::UNDELIVERED_INCOMPLETE_ADDRESS;
-    if (parcelStatus == "UNDELIVERED_LACK_OF_ACCESS_LETTERBOX")
-        return ParcelStatus::UNDELIVERED_LACK_OF_ACCESS_LETTERBOX;
-    if (parcelStatus == "UNDELIVERED_NO_MAILBOX")
-        return ParcelStatus::UNDELIVERED_NO_MAILBOX;
-    if (parcelStatus == "UNDELIVERED_NOT_LIVE_ADDRESS")
-        return ParcelStatus::UNDELIVERED_NOT_LIVE_ADDRESS;
-    if (parcelStatus == "UNDELIVERED_UNKNOWN_RECEIVER")
-        return ParcelStatus::UNDELIVERED_UNKNOWN_RECEIVER;
-    if (parcelStatus == "UNDELIVERED_WRONG_ADDRESS")
-        return ParcelStatus::UNDELIVERED_WRONG_ADDRESS;
-    if (parcelStatus == "UNSTACK_FROM_BOX_MACHINE")
-        return ParcelStatus::UNSTACK_FROM_BOX_MACHINE;
-    if (parcelStatus == "UNSTACK_FROM_CUSTOMER_SERVICE_POINT")
-        return ParcelStatus::UNSTACK_FROM_CUSTOMER_SERVICE_POINT;
-    if (parcelStatus == "COD_REJECTED")
-        return ParcelStatus::COD_REJECTED;
-    if (parcelStatus == "COD_COMPLETED")
-        return ParcelStatus::COD_COMPLETED;
-    if (parcelStatus == "C2X_REJECTED")
-        return ParcelStatus::C2X_REJECTED;
-    if (parcelStatus == "C2X_COMPLETED")
-        return ParcelStatus::C2X_COMPLETED;
-    if (parcelStatus == "AVIZO_REJECTED")
-        return ParcelStatus::AVIZO_REJECTED;
-    if (parcelStatus == "AVIZO_COMPLETED")
-        return ParcelStatus::AVIZO_COMPLETED;
-    return ParcelStatus::OTHER;
-}
-
-ParcelList::ParcelSize ParcelList::parseParcelSize(std::string parcelSize)
-{
-    if (parcelSize == "A")
-        return ParcelSize::A;
-    if (parcelSize == "B")
-        return ParcelSize::B;
-    if (parcelSize == "C")
-        return ParcelSize::C;
-    return ParcelSize::OTHER;
-}
-
-ParcelList::ParcelOwnershipStatus ParcelList::parseOwnershipStatus(std::string ownershipStatus)
-{
-    if (ownershipStatus == "OWN")
-        return ParcelOwnershipStatus::OWN;
-    if (ownershipStatus == "FRIEND")
-        return ParcelOwnershipStatus::FRIEND;
-    if (ownershipStatus == "OBSERVED")
-        return ParcelOwnershipStatus::OBSERVED;
-    return ParcelOwnershipStatus::NOT_SUPPORTED;
-}
-
-ParcelList::ParcelType ParcelList::parseParcelType(std::string parcelType)
-{
-    if (parcelType == "parcel")
-        return ParcelType::PARCEL;
-    if (parcelType == "courier")
-        return ParcelType::COURIER;
-    return ParcelType::OTHER;
+int ParcelList::shownCount(ApiClient::ParcelListType listType, int total, int shown)
+{
+    // Sent and Returns only grow, they become rows a page at a time as the view scrolls
+    if (listType != ApiClient::Sent && listType != ApiClient::Returns) return total;
+
+    return qMin(total, qMax(shown, PAGE_SIZE));
 }
 
-QString ParcelList::translateParcelStatus(ParcelStatus status) const
+QVector<ParcelList::Parcel> ParcelList::allParcels() const
 {
-    switch (status) {
-    case ParcelStatus::CREATED:
-        return tr("Created");
-    case ParcelStatus::ADOPTED_AT_SORTING_CENTER:
-        return tr("Adopted at sorting center");
-    case ParcelStatus::ADOPTED_AT_SOURCE_BRANCH:
-        return tr("Adopted at source branch");
-    case ParcelStatus::ADOPTED_AT_TARGET_BRANCH:
-        return tr("Adopted at target branch");
-    case ParcelStatus::AVIZO:
-        return tr("Avizo");
-    case ParcelStatus::CANCELED:
-        return tr("Cancelled");
-    case ParcelStatus::CANCELED_REDIRECT_TO_BOX:
-        return tr("Canceled redirect to box");
-    case ParcelStatus::CLAIMED:
-        return tr("Claimed");
-    case ParcelStatus::COLLECTED_FROM_SENDER:
-        return tr("Collected from sender");
-    case ParcelStatus::CONFIRMED:
-        return tr("Confirmed");
-    case ParcelStatus::DELAY_IN_DELIVERY:
-        return tr("Delay in delivery");
-    case ParcelStatus::DELIVERED:
-        return tr("Delivered");
-    case ParcelStatus::DISPATCHED_BY_SENDER:
-        return tr("Dispatched by sender");
-    case ParcelStatus::DISPATCHED_BY_SENDER_TO_POK:
-        return tr("Dispatched by sender to POK");
-    case ParcelStatus::MISSING:
-        return tr("Missing");
-    case ParcelStatus::OFFER_SELECTED:
-        return tr("Offer selected");
-    case ParcelStatus::OFFERS_PREPARED:
-        return tr("Offers prepared");
-    case ParcelStatus::OUT_FOR_DELIVERY:
-        return tr("Out for delivery");
-    case ParcelStatus::OUT_FOR_DELIVERY_TO_ADDRESS:
-        return tr("Out for delivery to address");
-    case ParcelStatus::OVERSIZED:
-        return tr("Oversized");
-    case ParcelStatus::PICKUP_REMINDER_SENT_ADDRESS:
-        return tr("Pickup reminder sent address");
-    case ParcelStatus::PICKUP_REMINDER_SENT:
-        return tr("Pickup reminder sent");
-    case ParcelStatus::PICKUP_TIME_EXPIRED:
-        return tr("Pickup time expired");
-    case ParcelStatus::READDRESSED:
-        return tr("Re-addressed");
-    case ParcelStatus::READY_TO_PICKUP:
-        return tr("Ready to pickup");
-    case ParcelStatus::READY_TO_PICKUP_FROM_BRANCH:
-        return tr("Ready to pickup from branch");
-    case ParcelStatus::READY_TO_PICKUP_FROM_POK:
-        return tr("Ready to pickup from POK");
-    case ParcelStatus::READY_TO_PICKUP_FROM_POK_REGISTERED:
-        return tr("Ready to pickup from POK registered");
-    case ParcelStatus::REDIRECT_TO_BOX:
-        return tr("Redirect to box");
-    case ParcelStatus::REJECTED_BY_RECEIVER:
-        return tr("Rejected by receiver");
-    case ParcelStatus::RETURNED_TO_SENDER:
-        return tr("Returned to sender");
-    case ParcelStatus::RETURN_PICKUP_CONFIRMATION_TO_SENDER:
-        return tr("Return pickup confirmation to sender");
-    case ParcelStatus::SENT_FROM_SORTING_CENTER:
-        return tr("Sent from sorting center");
-    case ParcelStatus::SENT_FROM_SOURCE_BRANCH:
-        return tr("Sent from source branch");
-    case ParcelStatus::STACK_IN_BOX_MACHINE:
-        return tr("Stack in box machine");
-    case ParcelStatus::STACK_IN_CUSTOMER_SERVICE_POINT:
-        return tr("Stack in customer service point");
-    case ParcelStatus::STACK_PARCEL_PICKUP_TIME_EXPIRED:
-        return tr("Stack parcel pickup time expired");
-    case ParcelStatus::STACK_PARCEL_IN_BOX_MACHINE_PICKUP_TIME_EXPIRED:
-        return tr("Stack parcel in box machine pickup time expired");
-    case ParcelStatus::TAKEN_BY_COURIER:
-        return tr("Taken by courier");
-    case ParcelStatus::TAKEN_BY_COURIER_FROM_POK:
-        return tr("Taken by courier from POK");
-    case ParcelStatus::UNDELIVERED:
-        return tr("Undelivered");
-    case ParcelStatus::UNDELIVERED_COD_CASH_RECEIVER:
-        return tr("Undelivered cod cash receiver");
-    case ParcelStatus::UNDELIVERED_INCOMPLETE_ADDRESS:
-        return tr("Undelivered incomplete address");
-    case ParcelStatus::UNDELIVERED_LACK_OF_ACCESS_LETTERBOX:
-        return tr("Undelivered lack of access letterbox");
-    case ParcelStatus::UNDELIVERED_NO_MAILBOX:
-        return tr("Undelivered no mailbox");
-    case ParcelStatus::UNDELIVERED_NOT_LIVE_ADDRESS:
-        return tr("Undelivered not live address");
-    case ParcelStatus::UNDELIVERED_UNKNOWN_RECEIVER:
-        return tr("Undelivered unknown receiver");
-    case ParcelStatus::UNDELIVERED_WRONG_ADDRESS:
-        return tr("Undelivered wrong address");
-    case ParcelStatus::UNSTACK_FROM_BOX_MACHINE:
-        return tr("Unstack from box macine");
-    case ParcelStatus::UNSTACK_FROM_CUSTOMER_SERVICE_POINT:
-        return tr("Unstack from customer service point");
-    case ParcelStatus::COD_REJECTED:
-        return tr("COD rejected");
-    case ParcelStatus::COD_COMPLETED:
-        return tr("COD completed");
-    case ParcelStatus::C2X_REJECTED:
-        return tr("C2X rejected");
-    case ParcelStatus::C2X_COMPLETED:
-        return tr("C2X completed");
-    case ParcelStatus::AVIZO_REJECTED:
-        return tr("Avizo rejected");
-    case ParcelStatus::AVIZO_COMPLETED:
-        return tr("Avizo completed");
-    default:
-        return tr("Other");
+    return _more.isEmpty() ? _parcels : _parcels + _more;
+}
+
+bool ParcelList::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !_more.isEmpty();
+}
+
+void ParcelList::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) return;
+
+    show(qMin(PAGE_SIZE, _more.size()));
+}
+
+void ParcelList::fetchAll()
+{
+    show(_more.size());
+}
+
+void ParcelList::show(int count)
+{
+    if (count <= 0) return;
+
+    beginInsertRows(QModelIndex(), _parcels.size(), _parcels.size() + count - 1);
+    _parcels += _more.mid(0, count);
+    _more.remove(0, count);
+    endInsertRows();
+}
+
+void ParcelList::diff(const QVector<Parcel> &parcels)
+{
+    QSet<ShipmentNumber> keys, existing;
+    for (const Parcel &parcel : parcels) keys.insert(parcel.shipmentNumber);
+    for (const Parcel &parcel : _parcels) existing.insert(parcel.shipmentNumber);
+
+    // Shipment numbers are the diff key, fall back to a reset if they are not unique
+    if (keys.size() != parcels.size() || existing.size() != _parcels.size()) {
+        beginResetModel();
+        _parcels = parcels;
+        endResetModel();
+        return;
+    }
+
+    for (int row = _parcels.size() - 1; row >= 0; row--) {
+        if (keys.contains(_parcels[row].shipmentNumber)) continue;
+
+        int last = row;
+        while (row > 0 && !keys.contains(_parcels[row - 1].shipmentNumber)) row--;
+
+        beginRemoveRows(QModelIndex(), row, last);
+        _parcels.remove(row, last - row + 1);
+        endRemoveRows();
+    }
+
+    for (int row = 0; row < parcels.size(); row++) {
+        if (!existing.contains(parcels[row].shipmentNumber)) {
+            int last = row;
+            while (last + 1 < parcels.size() && !existing.contains(parcels[last + 1].shipmentNumber)) last++;
+
+            beginInsertRows(QModelIndex(), row, last);
+            for (int i = row; i <= last; i++) _parcels.insert(i, parcels[i]);
+            endInsertRows();
+
+            row = last;
+            continue;
+        }
+
+        // Everything above row already matches, so the parcel can only be further down
+        if (_parcels[row].shipmentNumber != parcels[row].shipmentNumber) {
+            int from = row + 1;
+            while (_parcels[from].shipmentNumber != parcels[row].shipmentNumber) from++;
+
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+            _parcels.move(from, row);
+            endMoveRows();
+        }
+
+        QVector<int> roles = changedRoles(_parcels[row], parcels[row]);
+        _parcels[row] = parcels[row];
+        if (!roles.isEmpty()) emit dataChanged(index(row), index(row), roles);
     }
 }
 
+QVector<int> ParcelList::changedRoles(const Parcel &before, const Parcel &after)
+{
+    QVector<int> roles;
+    if (before.senderName != after.senderName) roles.append(SenderNameRole);
+    if (before.openCode != after.openCode) roles.append(OpenCodeRole);
+    if (before.size != after.size) roles.append(SizeRole);
+    if (before.qrCode != after.qrCode) roles.append(QrCodeRole);
+    if (before.status != after.status) roles.append(StatusRole);
+    if (before.type != after.type) roles.append(TypeRole);
+    if (before.ownershipStatus != after.ownershipStatus) roles.append(OwnershipRole);
+    return roles;
+}
+
+ParcelList::ParcelStatus ParcelList::parseParcelStatus(std::string_view parcelStatus)
+{
+    const StatusInfo *info = lookup(STATUSES, parcelStatus);
+    return info ? info->value : ParcelStatus::OTHER;
+}
+
+ParcelList::ParcelSize ParcelList::parseParcelSize(std::string_view parcelSize)
+{
+    const NamedValue<ParcelSize> *size = lookup(SIZES, parcelSize);
+    return size ? size->value : ParcelSize::OTHER;
+}
+
+ParcelList::ParcelOwnershipStatus ParcelList::parseOwnershipStatus(std::string_view ownershipStatus)
+{
+    const NamedValue<ParcelOwnershipStatus> *ownership = lookup(OWNERSHIP_STATUSES, ownershipStatus);
+    return ownership ? ownership->value : ParcelOwnershipStatus::NOT_SUPPORTED;
+}
+
+ParcelList::ParcelType ParcelList::parseParcelType(std::string_view parcelType)
+{
+    const NamedValue<ParcelType> *type = lookup(TYPES, parcelType);
+    return type ? type->value : ParcelType::OTHER;
+}
+
+bool ParcelList::isPending(ParcelStatus status)
+{
+    return PENDING_STATUSES.test(static_cast<std::size_t>(status));
+}
+
+QString ParcelList::translateParcelStatus(ParcelStatus status) const
+{
+    const char *text = STATUS_TEXTS[static_cast<std::size_t>(status)];
+    return text ? tr(text) : tr("Other");
+}
+
 QString ParcelList::translateParcelSize(ParcelSize size) const
 {
     switch (size) {
@@ -3,12 +3,19 @@
 
 #include <QAbstractListModel>
 #include <QObject>
+#include <QStringList>
+#include <string_view>
 #include "apiclient.h"
+#include "shipmentnumber.h"
+
+struct ParcelPayload;
 
 class ParcelList : public QAbstractListModel
 {
     Q_CLASSINFO("RegisterEnumClassesUnscoped", "false")
     Q_OBJECT
+    friend class ParcelListBenchmark;
+    Q_PROPERTY(bool loading READ getLoading NOTIFY loadingChanged)
 public:
     enum ParcelRoles {
         IdRole = Qt::UserRole + 1,
@@ -22,7 +29,7 @@ public:
         OwnershipRole
     };
 
-    enum class ParcelStatus {
+    enum class ParcelStatus : quint8 {
         CREATED,
         ADOPTED_AT_SORTING_CENTER,
         ADOPTED_AT_SOURCE_BRANCH,
@@ -83,7 +90,7 @@ public:
     };
     Q_ENUM(ParcelStatus)
 
-    enum class ParcelSize {
+    enum class ParcelSize : quint8 {
         A,
         B,
         C,
@@ -91,7 +98,7 @@ public:
     };
     Q_ENUM(ParcelSize)
 
-    enum class ParcelOwnershipStatus {
+    enum class ParcelOwnershipStatus : quint8 {
         OWN,
         FRIEND,
         OBSERVED,
@@ -99,7 +106,7 @@ public:
     };
     Q_ENUM(ParcelOwnershipStatus)
 
-    enum class ParcelType {
+    enum class ParcelType : quint8 {
         PARCEL,
         COURIER,
         MULTICOMPARTMENT,
@@ -107,49 +114,109 @@ public:
     };
     Q_ENUM(ParcelType)
 
+    // Sender names are interned per payload, so the thousands of parcels from one shop
+    // share a single string. Multi-compartment shipment numbers are a range in the
+    // compartments array of the payload, or list, the parcel belongs to.
     struct Parcel {
-        QString shipmentNumber;
+        ShipmentNumber shipmentNumber;
         QString senderName;
         QString openCode;
-        ParcelOwnershipStatus ownershipStatus;
-        ParcelSize size;
         QString qrCode;
+        quint32 compartmentsBegin = 0;
+        quint16 compartmentsCount = 0;
+        ParcelOwnershipStatus ownershipStatus = ParcelOwnershipStatus::NOT_SUPPORTED;
+        ParcelSize size = ParcelSize::OTHER;
         ParcelStatus status = ParcelStatus::OTHER;
         ParcelType type = ParcelType::OTHER;
-        QString multiCompartment = "";
     };
 
     explicit ParcelList(ApiClient *apiClient = nullptr, QObject *parent = nullptr);
 
+    static const int PAGE_SIZE = 50;
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+    // Turns every remaining page into rows at once, for searches over the whole list
+    void fetchAll();
     QVariant data(const QModelIndex &index, int role = IdRole) const;
     QHash<int, QByteArray> roleNames() const;
 
     Q_INVOKABLE void load(unsigned int listTypeIndex);
     Q_INVOKABLE void load(ApiClient::ParcelListType listType = ApiClient::ParcelListType::Pending);
+    Q_INVOKABLE void reload();
+    // Fetch the current list again, served from the API cache while it is fresh
+    void refresh();
+    // Fetches the lists that aren't shown so switching to them needs no round-trip
+    void prefetch();
+    // Tracking changes not confirmed by the server yet, true for parcels being added
+    void setTracking(const QHash<ShipmentNumber, bool> &tracking);
+
+    // Display strings follow the translator, call it after installing another one
+    void retranslate();
+
+    // ParcelStatus values from 0 up to this one are known, counted from the status table
+    static const std::size_t STATUS_COUNT;
+
+    static ParcelStatus parseParcelStatus(std::string_view parcelStatus);
+    static ParcelSize parseParcelSize(std::string_view parcelSize);
+    static ParcelOwnershipStatus parseOwnershipStatus(std::string_view ownershipStatus);
+    static ParcelType parseParcelType(std::string_view parcelType);
+    static bool isPending(ParcelStatus status);
+
+    bool getLoading() const;
+    // The parcels that are rows, paged lists may hold more
+    const QVector<Parcel> &getParcels() const;
+
+signals:
+    void loadingChanged();
+    // A fetch of the current list finished, whether or not anything changed
+    void refreshed();
+    // QR codes of parcels waiting in a locker, worth rendering before they are asked for
+    void pickupQrCodes(QStringList qrCodes);
 
 private:
-    ParcelStatus parseParcelStatus(std::string parcelStatus);
-    ParcelSize parseParcelSize(std::string parcelSize);
-    ParcelOwnershipStatus parseOwnershipStatus(std::string ownershipStatus);
-    ParcelType parseParcelType(std::string parcelType);
+    void setLoading(bool loading);
+    void fetch(bool force);
+    void populate(const ParcelPayload &payload);
+    bool patch(const ParcelPayload &payload, QVector<Parcel> &changed);
+    static QVector<Parcel> filter(ApiClient::ParcelListType listType, const ParcelPayload &payload);
+    void update(const QVector<Parcel> &parcels);
+    QVector<Parcel> overlay(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels) const;
+    void diff(const QVector<Parcel> &parcels);
+    void show(int count);
+    static int shownCount(ApiClient::ParcelListType listType, int total, int shown);
+    QVector<Parcel> allParcels() const;
+    static QVector<int> changedRoles(const Parcel &before, const Parcel &after);
+    void showSnapshot(ApiClient::ParcelListType listType);
+    void showList(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels);
+    void setList(ApiClient::ParcelListType listType, const QVector<Parcel> &parcels, const QVector<ShipmentNumber> &compartments);
+    void announcePickupQrCodes(const QVector<Parcel> &parcels);
+    void onNeedsAuthorizationChanged();
+    void translateTexts();
     QString translateParcelStatus(ParcelStatus status) const;
     QString translateParcelSize(ParcelSize size) const;
     QString translateParcelType(ParcelType type) const;
 
 private:
     QVector<Parcel> _parcels;
+    // Parcels of a paged list that aren't rows yet
+    QVector<Parcel> _more;
+    QHash<int, QVector<Parcel>> _lists;
+    // Multi-compartment shipment numbers the parcels of each list point into
+    QHash<int, QVector<ShipmentNumber>> _compartments;
+    QHash<int, quint64> _revisions;
+    QHash<ShipmentNumber, bool> _tracking;
+    // Position of each parcel in rows and pages together, built when a patch needs it
+    QHash<ShipmentNumber, int> _positions;
+    // Display strings for the current language, indexed by enum value
+    QVector<QString> _statusTexts;
+    QVector<QString> _sizeTexts;
+    QVector<QString> _typeTexts;
     ApiClient *_apiClient;
-    ApiClient::ParcelListType _listType;
-    const QVector<ParcelStatus> _pendingStatuses = {
-        ParcelStatus::READY_TO_PICKUP, ParcelStatus::CONFIRMED,
-        ParcelStatus::ADOPTED_AT_SORTING_CENTER, ParcelStatus::ADOPTED_AT_SOURCE_BRANCH,
-        ParcelStatus::COLLECTED_FROM_SENDER, ParcelStatus::DISPATCHED_BY_SENDER,
-        ParcelStatus::DISPATCHED_BY_SENDER_TO_POK, ParcelStatus::OUT_FOR_DELIVERY,
-        ParcelStatus::OUT_FOR_DELIVERY_TO_ADDRESS, ParcelStatus::SENT_FROM_SOURCE_BRANCH,
-        ParcelStatus::TAKEN_BY_COURIER, ParcelStatus::TAKEN_BY_COURIER_FROM_POK,
-        ParcelStatus::STACK_IN_BOX_MACHINE, ParcelStatus::STACK_IN_CUSTOMER_SERVICE_POINT
-    };
+    ApiClient::ParcelListType _listType = ApiClient::Pending;
+    unsigned int _loadGeneration = 0;
+    bool _loading = false;
 };
 Q_DECLARE_METATYPE(ParcelList::ParcelSize)
 
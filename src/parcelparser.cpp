@@ -0,0 +1,290 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include "parcelparser.h"
+
+std::shared_ptr<const ParcelPayload> ParcelParser::parse(const std::string &body, bool sent)
+{
+    // A parcel takes roughly a kilobyte of JSON, good enough to avoid most reallocations
+    ParcelParser parser(sent, body.size() / 1024);
+    if (!nlohmann::json::sax_parse(body, &parser) || !parser._hasParcels) return nullptr;
+
+    // The API lists the oldest parcels first
+    std::reverse(parser._parcels.begin(), parser._parcels.end());
+
+    std::shared_ptr<ParcelPayload> payload = std::make_shared<ParcelPayload>();
+    payload->parcels = parser._parcels;
+    payload->compartments = parser._compartments;
+    payload->updatedUntil = parser._updatedUntil;
+
+    payload->hashes.reserve(payload->parcels.size());
+    for (const ParcelList::Parcel &parcel : payload->parcels) {
+        payload->hashes.append(hash(parcel, payload->compartments));
+    }
+
+    return payload;
+}
+
+uint ParcelParser::hash(const ParcelList::Parcel &parcel, const QVector<ShipmentNumber> &compartments)
+{
+    uint seed = qHash(parcel.shipmentNumber);
+    seed = qHash(parcel.senderName, seed);
+    seed = qHash(parcel.openCode, seed);
+    seed = qHash(parcel.qrCode, seed);
+    seed = qHash(static_cast<quint8>(parcel.ownershipStatus), seed);
+    seed = qHash(static_cast<quint8>(parcel.size), seed);
+    seed = qHash(static_cast<quint8>(parcel.status), seed);
+    seed = qHash(static_cast<quint8>(parcel.type), seed);
+
+    // The compartment numbers, not where they happen to sit in the array
+    for (quint32 i = parcel.compartmentsBegin; i < parcel.compartmentsBegin + parcel.compartmentsCount; i++) {
+        seed = qHash(compartments[i], seed);
+    }
+
+    return seed;
+}
+
+ParcelParser::ParcelParser(bool sent, std::size_t sizeHint) : _sent(sent)
+{
+    _stack.reserve(8);
+    _parcels.reserve(static_cast<int>(sizeHint));
+}
+
+bool ParcelParser::null()
+{
+    return scalar();
+}
+
+bool ParcelParser::boolean(bool val)
+{
+    Q_UNUSED(val)
+    return scalar();
+}
+
+bool ParcelParser::number_integer(number_integer_t val)
+{
+    Q_UNUSED(val)
+    return scalar();
+}
+
+bool ParcelParser::number_unsigned(number_unsigned_t val)
+{
+    Q_UNUSED(val)
+    return scalar();
+}
+
+bool ParcelParser::number_float(number_float_t val, const string_t &s)
+{
+    Q_UNUSED(val)
+    Q_UNUSED(s)
+    return scalar();
+}
+
+bool ParcelParser::binary(binary_t &val)
+{
+    Q_UNUSED(val)
+    return scalar();
+}
+
+bool ParcelParser::string(string_t &val)
+{
+    Field field = current();
+
+    if (at({Field::Root, Field::Parcels, Field::Item})) {
+        switch (field) {
+        case Field::ShipmentNumber:
+            _parcel.shipmentNumber = ShipmentNumber(val);
+            break;
+        case Field::OpenCode:
+            _parcel.openCode = QString::fromStdString(val);
+            break;
+        case Field::OwnershipStatus:
+            _parcel.ownershipStatus = ParcelList::parseOwnershipStatus(val);
+            break;
+        case Field::ParcelSize:
+            _parcel.size = ParcelList::parseParcelSize(val);
+            break;
+        case Field::QrCode:
+            _parcel.qrCode = QString::fromStdString(val);
+            break;
+        case Field::Status:
+            _parcel.status = ParcelList::parseParcelStatus(val);
+            break;
+        case Field::ShipmentType:
+            _parcel.type = ParcelList::parseParcelType(val);
+            break;
+        default:
+            break;
+        }
+    } else if (field == Field::Name && at({Field::Root, Field::Parcels, Field::Item, _sent ? Field::Receiver : Field::Sender})) {
+        // Share one string between every parcel from the same sender
+        _parcel.senderName = *_senderNames.insert(QString::fromStdString(val));
+    } else if (field == Field::UpdatedUntil && at({Field::Root})) {
+        _updatedUntil = val;
+    } else if (at({Field::Root, Field::Parcels, Field::Item, Field::MultiCompartment, Field::ShipmentNumbers})) {
+        _compartments.append(ShipmentNumber(val));
+        _parcel.compartmentsCount++;
+    } else {
+        return scalar();
+    }
+
+    return true;
+}
+
+bool ParcelParser::start_object(std::size_t elements)
+{
+    Q_UNUSED(elements)
+    return push(false);
+}
+
+bool ParcelParser::key(string_t &val)
+{
+    _key = parseField(val);
+    return true;
+}
+
+bool ParcelParser::end_object()
+{
+    return pop();
+}
+
+bool ParcelParser::start_array(std::size_t elements)
+{
+    Q_UNUSED(elements)
+    return push(true);
+}
+
+bool ParcelParser::end_array()
+{
+    return pop();
+}
+
+bool ParcelParser::parse_error(std::size_t position, const std::string &last_token, const nlohmann::detail::exception &ex)
+{
+    Q_UNUSED(position)
+    Q_UNUSED(last_token)
+    Q_UNUSED(ex)
+    return false;
+}
+
+bool ParcelParser::scalar()
+{
+    // multiCompartment and its shipmentNumbers only have to be present, whatever their value
+    if (current() == Field::MultiCompartment && at({Field::Root, Field::Parcels, Field::Item})) {
+        _hasMultiCompartment = true;
+    } else if (current() == Field::ShipmentNumbers && at({Field::Root, Field::Parcels, Field::Item, Field::MultiCompartment})) {
+        _hasShipmentNumbers = true;
+    }
+
+    return true;
+}
+
+bool ParcelParser::push(bool array)
+{
+    _stack.push_back(Frame{_stack.empty() ? Field::Root : current(), array});
+    _key = Field::Unknown;
+
+    if (array && at({Field::Root, Field::Parcels})) {
+        _hasParcels = true;
+    } else if (!array && at({Field::Root, Field::Parcels, Field::Item})) {
+        _parcel = ParcelList::Parcel();
+        _parcel.compartmentsBegin = static_cast<quint32>(_compartments.size());
+        _hasMultiCompartment = false;
+        _hasShipmentNumbers = false;
+    } else if (at({Field::Root, Field::Parcels, Field::Item, Field::MultiCompartment})) {
+        _hasMultiCompartment = true;
+    } else if (at({Field::Root, Field::Parcels, Field::Item, Field::MultiCompartment, Field::ShipmentNumbers})) {
+        _hasShipmentNumbers = true;
+    }
+
+    return true;
+}
+
+bool ParcelParser::pop()
+{
+    if (!_stack.back().array && at({Field::Root, Field::Parcels, Field::Item})) {
+        // Multi-compartment parcels without their shipment numbers can't be shown
+        if (_hasMultiCompartment) {
+            if (_hasShipmentNumbers) {
+                _parcel.type = ParcelList::ParcelType::MULTICOMPARTMENT;
+                _parcels.append(_parcel);
+            } else {
+                _compartments.resize(_parcel.compartmentsBegin);
+            }
+        } else {
+            _parcels.append(_parcel);
+        }
+    }
+
+    _stack.pop_back();
+    _key = Field::Unknown;
+    return true;
+}
+
+ParcelParser::Field ParcelParser::current() const
+{
+    return !_stack.empty() && _stack.back().array ? Field::Item : _key;
+}
+
+bool ParcelParser::at(std::initializer_list<Field> path) const
+{
+    if (path.size() != _stack.size()) return false;
+
+    return std::equal(path.begin(), path.end(), _stack.begin(), [](Field field, const Frame &frame) {
+        return field == frame.field;
+    });
+}
+
+ParcelParser::Field ParcelParser::parseField(const std::string &name)
+{
+    struct NamedField {
+        std::string_view name;
+        Field field;
+    };
+
+    // Sorted by name for binary search
+    static constexpr NamedField FIELDS[] = {
+        { "multiCompartment", Field::MultiCompartment },
+        { "name", Field::Name },
+        { "openCode", Field::OpenCode },
+        { "ownershipStatus", Field::OwnershipStatus },
+        { "parcelSize", Field::ParcelSize },
+        { "parcels", Field::Parcels },
+        { "qrCode", Field::QrCode },
+        { "receiver", Field::Receiver },
+        { "sender", Field::Sender },
+        { "shipmentNumber", Field::ShipmentNumber },
+        { "shipmentNumbers", Field::ShipmentNumbers },
+        { "shipmentType", Field::ShipmentType },
+        { "status", Field::Status },
+        { "updatedUntil", Field::UpdatedUntil },
+    };
+    static_assert(std::is_sorted(std::begin(FIELDS), std::end(FIELDS), [](const NamedField &a, const NamedField &b) {
+        return a.name < b.name;
+    }), "FIELDS must be sorted by name");
+
+    const NamedField *field = std::lower_bound(std::begin(FIELDS), std::end(FIELDS), name, [](const NamedField &candidate, std::string_view value) {
+        return candidate.name < value;
+    });
+    return field != std::end(FIELDS) && field->name == name ? field->field : Field::Unknown;
+}
@@ -0,0 +1,122 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARCELPARSER_H
+#define PARCELPARSER_H
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "parcellist.h"
+
+// Parsed parcel list endpoint response, shared between every list built from it
+struct ParcelPayload {
+    QVector<ParcelList::Parcel> parcels;
+    QVector<ShipmentNumber> compartments;
+    // Content hash of each parcel, to tell what a full response changed
+    QVector<uint> hashes;
+    // Sync watermark to ask for later changes with
+    std::string updatedUntil;
+
+    // Filled in by ParcelStore: the revision this payload was built from, and the
+    // indexes of the parcels that changed since. Anything else, parcels coming, going
+    // or moving, makes the change structural and the whole list has to be compared.
+    quint64 revision = 0;
+    quint64 baseRevision = 0;
+    QVector<int> changed;
+    bool structural = true;
+};
+
+// Decodes the parcels array of a list endpoint response straight into Parcel structs
+// in a single pass, fields it does not know are skipped without building a DOM.
+class ParcelParser : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+    static std::shared_ptr<const ParcelPayload> parse(const std::string &body, bool sent);
+    static uint hash(const ParcelList::Parcel &parcel, const QVector<ShipmentNumber> &compartments);
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t &s) override;
+    bool string(string_t &val) override;
+    bool binary(binary_t &val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t &val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string &last_token, const nlohmann::detail::exception &ex) override;
+
+private:
+    enum class Field {
+        Unknown,
+        Root,
+        Item,
+        Parcels,
+        ShipmentNumber,
+        OpenCode,
+        OwnershipStatus,
+        ParcelSize,
+        QrCode,
+        Status,
+        ShipmentType,
+        Sender,
+        Receiver,
+        Name,
+        MultiCompartment,
+        ShipmentNumbers,
+        UpdatedUntil
+    };
+
+    struct Frame {
+        Field field;
+        bool array;
+    };
+
+    explicit ParcelParser(bool sent, std::size_t sizeHint);
+
+    bool scalar();
+    bool push(bool array);
+    bool pop();
+    Field current() const;
+    bool at(std::initializer_list<Field> path) const;
+    static Field parseField(const std::string &name);
+
+private:
+    const bool _sent;
+    std::vector<Frame> _stack;
+    Field _key = Field::Unknown;
+    QVector<ParcelList::Parcel> _parcels;
+    ParcelList::Parcel _parcel;
+    QVector<ShipmentNumber> _compartments;
+    QSet<QString> _senderNames;
+    std::string _updatedUntil;
+    bool _hasParcels = false;
+    bool _hasMultiCompartment = false;
+    bool _hasShipmentNumbers = false;
+};
+
+#endif // PARCELPARSER_H
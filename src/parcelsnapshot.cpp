@@ -0,0 +1,90 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDataStream>
+#include <QSet>
+#include "parcelsnapshot.h"
+
+bool ParcelSnapshot::readParcels(QDataStream &stream, QVector<ParcelList::Parcel> &parcels, QVector<ShipmentNumber> &compartments)
+{
+    quint32 count;
+    stream >> count;
+
+    // Counts come from disk, a corrupt one mustn't reserve more than the bytes left can hold
+    qint64 available = stream.device() ? stream.device()->bytesAvailable() : 0;
+
+    QVector<ParcelList::Parcel> result;
+    QSet<QString> senderNames;
+    result.reserve(static_cast<int>(qMin<qint64>(count, available / MIN_PARCEL_SIZE)));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        ParcelList::Parcel parcel;
+        QString shipmentNumber, senderName;
+        quint8 ownershipStatus, size, status, type;
+
+        stream >> shipmentNumber >> senderName >> parcel.openCode >> parcel.qrCode >> parcel.compartmentsBegin >> parcel.compartmentsCount
+               >> ownershipStatus >> size >> status >> type;
+
+        parcel.shipmentNumber = ShipmentNumber(shipmentNumber);
+        parcel.senderName = *senderNames.insert(senderName);
+        // Values past the end of an enum index past the display strings, treat them as unknown
+        parcel.ownershipStatus = ownershipStatus <= static_cast<quint8>(ParcelList::ParcelOwnershipStatus::NOT_SUPPORTED) ? static_cast<ParcelList::ParcelOwnershipStatus>(ownershipStatus) : ParcelList::ParcelOwnershipStatus::NOT_SUPPORTED;
+        parcel.size = size <= static_cast<quint8>(ParcelList::ParcelSize::OTHER) ? static_cast<ParcelList::ParcelSize>(size) : ParcelList::ParcelSize::OTHER;
+        parcel.status = status < ParcelList::STATUS_COUNT ? static_cast<ParcelList::ParcelStatus>(status) : ParcelList::ParcelStatus::OTHER;
+        parcel.type = type <= static_cast<quint8>(ParcelList::ParcelType::OTHER) ? static_cast<ParcelList::ParcelType>(type) : ParcelList::ParcelType::OTHER;
+        result.append(parcel);
+    }
+
+    quint32 compartmentCount;
+    stream >> compartmentCount;
+
+    available = stream.device() ? stream.device()->bytesAvailable() : 0;
+
+    QVector<ShipmentNumber> numbers;
+    numbers.reserve(static_cast<int>(qMin<qint64>(compartmentCount, available / MIN_COMPARTMENT_SIZE)));
+    for (quint32 i = 0; i < compartmentCount && stream.status() == QDataStream::Ok; i++) {
+        QString number;
+        stream >> number;
+        numbers.append(ShipmentNumber(number));
+    }
+
+    if (stream.status() != QDataStream::Ok) return false;
+
+    for (const ParcelList::Parcel &parcel : result) {
+        if (static_cast<qint64>(parcel.compartmentsBegin) + parcel.compartmentsCount > numbers.size()) return false;
+    }
+
+    parcels = result;
+    compartments = numbers;
+    return true;
+}
+
+void ParcelSnapshot::writeParcels(QDataStream &stream, const QVector<ParcelList::Parcel> &parcels, const QVector<ShipmentNumber> &compartments)
+{
+    stream << static_cast<quint32>(parcels.size());
+
+    for (const ParcelList::Parcel &parcel : parcels) {
+        stream << parcel.shipmentNumber.toString() << parcel.senderName << parcel.openCode << parcel.qrCode << parcel.compartmentsBegin << parcel.compartmentsCount
+               << static_cast<quint8>(parcel.ownershipStatus) << static_cast<quint8>(parcel.size)
+               << static_cast<quint8>(parcel.status) << static_cast<quint8>(parcel.type);
+    }
+
+    stream << static_cast<quint32>(compartments.size());
+    for (const ShipmentNumber &number : compartments) stream << number.toString();
+}
@@ -0,0 +1,43 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARCELSNAPSHOT_H
+#define PARCELSNAPSHOT_H
+
+#include <QDataStream>
+#include <QString>
+#include <QVector>
+#include "parcellist.h"
+
+// Binary encoding of parcels and their compartments, used by the ParcelStore files and
+// by the sync daemon to hand payloads to the application.
+class ParcelSnapshot
+{
+public:
+    static bool readParcels(QDataStream &stream, QVector<ParcelList::Parcel> &parcels, QVector<ShipmentNumber> &compartments);
+    static void writeParcels(QDataStream &stream, const QVector<ParcelList::Parcel> &parcels, const QVector<ShipmentNumber> &compartments);
+
+private:
+    // Bytes a parcel and a compartment take at least: empty strings are a 4 byte length
+    static const int MIN_PARCEL_SIZE = 4 * 4 + 4 + 2 + 4;
+    static const int MIN_COMPARTMENT_SIZE = 4;
+};
+
+#endif // PARCELSNAPSHOT_H
@@ -0,0 +1,235 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include "parcelsnapshot.h"
+#include "parcelstore.h"
+
+std::shared_ptr<const ParcelPayload> ParcelStore::payload() const
+{
+    return _payload;
+}
+
+const std::string &ParcelStore::watermark() const
+{
+    static const std::string NONE;
+    return _payload ? _payload->updatedUntil : NONE;
+}
+
+bool ParcelStore::needsFullSync() const
+{
+    return !_payload || _payload->updatedUntil.empty() || QDateTime::currentMSecsSinceEpoch() / 1000 - _fullSync > FULL_SYNC_INTERVAL;
+}
+
+bool ParcelStore::replace(const ParcelPayload &response, quint64 revision)
+{
+    std::shared_ptr<ParcelPayload> payload = std::make_shared<ParcelPayload>(response);
+    payload->revision = revision;
+    payload->baseRevision = _payload ? _payload->revision : 0;
+    payload->structural = !_payload || payload->parcels.size() != _payload->parcels.size();
+
+    // Rows only change in place when every parcel is where it was. Compartment ranges
+    // of untouched rows have to stay valid too, so the arrays must match.
+    if (!payload->structural && payload->compartments != _payload->compartments) payload->structural = true;
+
+    for (int row = 0; row < payload->parcels.size() && !payload->structural; row++) {
+        if (payload->parcels[row].shipmentNumber != _payload->parcels[row].shipmentNumber) {
+            payload->structural = true;
+        } else if (payload->hashes[row] != _payload->hashes[row]) {
+            payload->changed.append(row);
+        }
+    }
+
+    _fullSync = QDateTime::currentMSecsSinceEpoch() / 1000;
+
+    if (!payload->structural && payload->changed.isEmpty()) {
+        // Nothing to show for it, but the watermark moves on
+        if (_payload && _payload->updatedUntil != response.updatedUntil) {
+            std::shared_ptr<ParcelPayload> updated = std::make_shared<ParcelPayload>(*_payload);
+            updated->updatedUntil = response.updatedUntil;
+            _payload = updated;
+        }
+        return false;
+    }
+
+    _payload = payload;
+    index();
+    return true;
+}
+
+bool ParcelStore::merge(const ParcelPayload &delta, quint64 revision)
+{
+    if (!_payload) return replace(delta, revision);
+
+    std::shared_ptr<ParcelPayload> payload = std::make_shared<ParcelPayload>(*_payload);
+    payload->revision = revision;
+    payload->baseRevision = _payload->revision;
+    payload->changed.clear();
+    payload->structural = false;
+    if (!delta.updatedUntil.empty()) payload->updatedUntil = delta.updatedUntil;
+
+    // Delta compartments go after the existing ones, so existing ranges stay valid
+    quint32 offset = static_cast<quint32>(payload->compartments.size());
+    QVector<ParcelList::Parcel> added;
+    QVector<uint> addedHashes;
+
+    for (int i = 0; i < delta.parcels.size(); i++) {
+        ParcelList::Parcel parcel = delta.parcels[i];
+        auto row = _rows.constFind(parcel.shipmentNumber);
+        if (row != _rows.constEnd() && payload->hashes[row.value()] == delta.hashes[i]) continue;
+
+        for (quint32 c = parcel.compartmentsBegin; c < parcel.compartmentsBegin + parcel.compartmentsCount; c++) {
+            payload->compartments.append(delta.compartments[c]);
+        }
+        parcel.compartmentsBegin = offset;
+        offset += parcel.compartmentsCount;
+
+        if (row != _rows.constEnd()) {
+            payload->parcels[row.value()] = parcel;
+            payload->hashes[row.value()] = delta.hashes[i];
+            payload->changed.append(row.value());
+        } else {
+            added.append(parcel);
+            addedHashes.append(delta.hashes[i]);
+        }
+    }
+
+    if (payload->changed.isEmpty() && added.isEmpty()) {
+        // Only the watermark moved
+        _payload = payload;
+        return false;
+    }
+
+    if (!added.isEmpty()) {
+        // New parcels are the most recent ones, the list is newest first
+        payload->parcels = added + payload->parcels;
+        payload->hashes = addedHashes + payload->hashes;
+        payload->changed.clear();
+        payload->structural = true;
+    }
+
+    // Replaced ranges stay behind until half the array is garbage, then every range moves
+    int live = 0;
+    for (const ParcelList::Parcel &parcel : payload->parcels) live += parcel.compartmentsCount;
+    if (payload->compartments.size() > 2 * live + COMPARTMENT_SLACK) {
+        compact(payload->parcels, payload->compartments);
+        payload->changed.clear();
+        payload->structural = true;
+    }
+
+    _payload = payload;
+    if (payload->structural) index();
+    return true;
+}
+
+bool ParcelStore::read(const QString &path, quint64 revision)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) return false;
+
+    // Years of sent and returned parcels make a large file, it is read through a memory map
+    uchar *memory = file.map(0, file.size());
+    if (memory == nullptr) return false;
+
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(memory), file.size());
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic, version;
+    QByteArray watermark;
+    qint64 fullSync;
+    stream >> magic >> version;
+    if (magic != MAGIC || version != VERSION) return false;
+    stream >> watermark >> fullSync;
+
+    std::shared_ptr<ParcelPayload> payload = std::make_shared<ParcelPayload>();
+    if (!ParcelSnapshot::readParcels(stream, payload->parcels, payload->compartments)) return false;
+
+    payload->updatedUntil = watermark.toStdString();
+    payload->revision = revision;
+    payload->hashes.reserve(payload->parcels.size());
+    for (const ParcelList::Parcel &parcel : payload->parcels) {
+        payload->hashes.append(ParcelParser::hash(parcel, payload->compartments));
+    }
+
+    _payload = payload;
+    _fullSync = fullSync;
+    index();
+    return true;
+}
+
+bool ParcelStore::write(const QString &path) const
+{
+    if (!_payload) return false;
+
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << MAGIC << VERSION << QByteArray::fromStdString(_payload->updatedUntil) << _fullSync;
+
+    // Ranges replaced by deltas aren't written
+    QVector<ParcelList::Parcel> parcels = _payload->parcels;
+    QVector<ShipmentNumber> compartments = _payload->compartments;
+    compact(parcels, compartments);
+    ParcelSnapshot::writeParcels(stream, parcels, compartments);
+
+    return file.commit();
+}
+
+void ParcelStore::remove(const QString &path)
+{
+    QFile::remove(path);
+}
+
+void ParcelStore::compact(QVector<ParcelList::Parcel> &parcels, QVector<ShipmentNumber> &compartments)
+{
+    int count = 0;
+    for (const ParcelList::Parcel &parcel : parcels) count += parcel.compartmentsCount;
+    if (count == compartments.size()) return;
+
+    QVector<ShipmentNumber> live;
+    live.reserve(count);
+    for (ParcelList::Parcel &parcel : parcels) {
+        quint32 begin = static_cast<quint32>(live.size());
+        for (quint32 c = parcel.compartmentsBegin; c < parcel.compartmentsBegin + parcel.compartmentsCount; c++) {
+            live.append(compartments[c]);
+        }
+        parcel.compartmentsBegin = begin;
+    }
+
+    compartments = live;
+}
+
+void ParcelStore::index()
+{
+    _rows.clear();
+    _rows.reserve(_payload->parcels.size());
+    for (int row = 0; row < _payload->parcels.size(); row++) {
+        _rows.insert(_payload->parcels[row].shipmentNumber, row);
+    }
+}
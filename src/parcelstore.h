@@ -0,0 +1,71 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARCELSTORE_H
+#define PARCELSTORE_H
+
+#include <QHash>
+#include <QString>
+#include <memory>
+#include <string>
+#include "parcelparser.h"
+
+// The local, authoritative copy of one parcel endpoint for the signed in account.
+// Delta responses, only the parcels updated after the watermark, are merged in; full
+// responses replace the content and are compared with it by content hash. Either way
+// the resulting payload records which parcels changed so models can update just those.
+class ParcelStore
+{
+public:
+    // A full sync now and then catches parcels that left the list, deltas don't report them
+    static const qint64 FULL_SYNC_INTERVAL = 24 * 60 * 60;
+
+    std::shared_ptr<const ParcelPayload> payload() const;
+    const std::string &watermark() const;
+    bool needsFullSync() const;
+
+    // Both return whether the content changed, the new payload gets the given revision
+    bool replace(const ParcelPayload &response, quint64 revision);
+    bool merge(const ParcelPayload &delta, quint64 revision);
+
+    // The loaded payload gets the given revision. Safe to call from another thread.
+    bool read(const QString &path, quint64 revision);
+    // Safe to call from another thread with a copy of the store
+    bool write(const QString &path) const;
+    static void remove(const QString &path);
+
+private:
+    // Drops the compartments no parcel points at any more
+    static void compact(QVector<ParcelList::Parcel> &parcels, QVector<ShipmentNumber> &compartments);
+    void index();
+
+private:
+    static const quint32 MAGIC = 0x4f505344;
+    static const quint32 VERSION = 1;
+    // Garbage compartments allowed on top of half the array before a merge compacts it
+    static const int COMPARTMENT_SLACK = 64;
+
+    std::shared_ptr<const ParcelPayload> _payload;
+    // Position of each parcel in the payload
+    QHash<ShipmentNumber, int> _rows;
+    qint64 _fullSync = 0;
+};
+
+#endif // PARCELSTORE_H
@@ -0,0 +1,113 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include "QZXing.h"
+#include "qrcodecache.h"
+
+QrCodeCache::QrCodeCache(QObject *parent) : QObject(parent)
+{
+    // A handful of full screen codes
+    _images.setMaxCost(16 * 1024);
+    _pool.setMaxThreadCount(1);
+}
+
+QrCodeCache::~QrCodeCache()
+{
+    _pool.waitForDone();
+}
+
+QImage QrCodeCache::image(const QString &qrCode, QSize size)
+{
+    QString name = key(qrCode, size);
+    unsigned int generation;
+
+    {
+        QMutexLocker locker(&_mutex);
+        if (QImage *image = _images.object(name)) return *image;
+        generation = _generation;
+    }
+
+    QString path = directory() + "/" + name + ".png";
+    QImage image(path);
+
+    if (image.isNull()) {
+        image = QZXing::encodeData(qrCode, QZXing::EncoderFormat_QR_CODE, size, QZXing::EncodeErrorCorrectionLevel_H, true);
+        if (image.isNull()) return image;
+
+        QDir().mkpath(directory());
+        QSaveFile file(path);
+        if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG")) file.commit();
+    }
+
+    QMutexLocker locker(&_mutex);
+    if (generation == _generation) _images.insert(name, new QImage(image), qMax(1, image.byteCount() / 1024));
+
+    return image;
+}
+
+void QrCodeCache::prerender(const QStringList &qrCodes, QSize size)
+{
+    for (const QString &qrCode : qrCodes) {
+        if (qrCode.isEmpty()) continue;
+
+        QtConcurrent::run(&_pool, [this, qrCode, size]() {
+            image(qrCode, size);
+        });
+    }
+}
+
+void QrCodeCache::clear()
+{
+    _pool.clear();
+
+    {
+        QMutexLocker locker(&_mutex);
+        _images.clear();
+        _generation++;
+    }
+
+    // The pool has one thread, so this runs after a render in progress and removes its file too
+    QtConcurrent::run(&_pool, []() {
+        QDir(directory()).removeRecursively();
+    });
+}
+
+QThreadPool *QrCodeCache::pool()
+{
+    return &_pool;
+}
+
+QString QrCodeCache::key(const QString &qrCode, QSize size)
+{
+    // Codes don't make safe file names, and shouldn't be readable from the cache listing
+    QByteArray hash = QCryptographicHash::hash(qrCode.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QString("%1-%2x%3").arg(QString::fromLatin1(hash)).arg(size.width()).arg(size.height());
+}
+
+QString QrCodeCache::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/qrcodes";
+}
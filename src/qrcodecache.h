@@ -0,0 +1,63 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef QRCODECACHE_H
+#define QRCODECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+#include <QThreadPool>
+
+// Rendered QR codes, kept in a memory LRU and as PNGs in the cache directory so the
+// code shows up at once in front of the locker, network or not.
+class QrCodeCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QrCodeCache(QObject *parent = nullptr);
+    ~QrCodeCache();
+
+    // Blocks while encoding on a miss, call it from pool()
+    QImage image(const QString &qrCode, QSize size);
+    // Renders missing codes in the background
+    void prerender(const QStringList &qrCodes, QSize size);
+    // Doesn't wait for a render in progress, its result is dropped
+    void clear();
+
+    QThreadPool *pool();
+
+private:
+    static QString key(const QString &qrCode, QSize size);
+    static QString directory();
+
+private:
+    // Cost is in kilobytes
+    QCache<QString, QImage> _images;
+    // Bumped by clear(), renders started before it don't go into the cache
+    unsigned int _generation = 0;
+    QMutex _mutex;
+    QThreadPool _pool;
+};
+
+#endif // QRCODECACHE_H
@@ -0,0 +1,94 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QFutureInterface>
+#include <QRunnable>
+#include "qrcodeprovider.h"
+
+namespace {
+
+// Renders on the cache pool at a priority of its own, which QtConcurrent::run can't give
+class QrCodeJob : public QRunnable
+{
+public:
+    QrCodeJob(QrCodeCache *cache, QString qrCode, QSize size) : _cache(cache), _qrCode(qrCode), _size(size)
+    {
+        _result.reportStarted();
+    }
+
+    ~QrCodeJob()
+    {
+        // Dropped by QrCodeCache::clear() before it ran, the response still has to finish
+        if (!_result.isFinished()) {
+            _result.reportCanceled();
+            _result.reportFinished();
+        }
+    }
+
+    QFuture<QImage> future()
+    {
+        return _result.future();
+    }
+
+    void run() override
+    {
+        QImage image = _cache->image(_qrCode, _size);
+        _result.reportResult(image);
+        _result.reportFinished();
+    }
+
+private:
+    QFutureInterface<QImage> _result;
+    QrCodeCache *_cache;
+    QString _qrCode;
+    QSize _size;
+};
+
+}
+
+QrCodeProvider::QrCodeProvider(QrCodeCache *cache) : _cache(cache)
+{
+}
+
+QQuickImageResponse *QrCodeProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    QSize size = requestedSize.isValid() && !requestedSize.isEmpty() ? requestedSize : QSize(DEFAULT_SIZE, DEFAULT_SIZE);
+
+    QrCodeJob *job = new QrCodeJob(_cache, id, size);
+    QrCodeResponse *response = new QrCodeResponse(job->future());
+    // Ahead of any codes still being pre-rendered
+    _cache->pool()->start(job, 1);
+
+    return response;
+}
+
+QrCodeResponse::QrCodeResponse(QFuture<QImage> image)
+{
+    QObject::connect(&_watcher, &QFutureWatcher<QImage>::finished, this, [this]() {
+        if (!_watcher.isCanceled()) _image = _watcher.result();
+        emit finished();
+    });
+    _watcher.setFuture(image);
+}
+
+QQuickTextureFactory *QrCodeResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(_image);
+}
@@ -0,0 +1,56 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef QRCODEPROVIDER_H
+#define QRCODEPROVIDER_H
+
+#include <QFutureWatcher>
+#include <QQuickAsyncImageProvider>
+#include <QQuickImageResponse>
+#include "qrcodecache.h"
+
+// Serves image://qrcode/<qrCode> from QrCodeCache without blocking the GUI thread
+class QrCodeProvider : public QQuickAsyncImageProvider
+{
+public:
+    static const int DEFAULT_SIZE = 512;
+
+    explicit QrCodeProvider(QrCodeCache *cache);
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    QrCodeCache *_cache;
+};
+
+// Waits for the image through a future, the engine can delete it before the image is ready
+class QrCodeResponse : public QQuickImageResponse
+{
+public:
+    explicit QrCodeResponse(QFuture<QImage> image);
+
+    QQuickTextureFactory *textureFactory() const override;
+
+private:
+    QFutureWatcher<QImage> _watcher;
+    QImage _image;
+};
+
+#endif // QRCODEPROVIDER_H
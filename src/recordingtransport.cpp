@@ -0,0 +1,88 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QMutexLocker>
+#include <nlohmann/json.hpp>
+#include "endpoints.h"
+#include "recordingtransport.h"
+
+RecordingTransport::RecordingTransport(std::unique_ptr<HttpTransport> transport, QString path) :
+    _transport(std::move(transport)), _file(path)
+{
+    _file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+bool RecordingTransport::carriesCredentials(const std::string &url)
+{
+    // By path, so recordings against another host are redacted as well
+    std::string path = url.substr(0, url.find('?'));
+    for (const std::string *endpoint : { &Endpoints::SMS_SEND_CODE, &Endpoints::SMS_CONFIRM_CODE, &Endpoints::REFRESH_TOKEN }) {
+        std::string suffix = endpoint->substr(endpoint->find('/', endpoint->find("//") + 2));
+        if (path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0) return true;
+    }
+    return false;
+}
+
+bool RecordingTransport::redact(nlohmann::json &body, std::initializer_list<const char *> keys)
+{
+    if (!body.is_object()) return false;
+
+    bool redacted = false;
+    for (const char *key : keys) {
+        if (!body.contains(key)) continue;
+        body[key] = "recorded";
+        redacted = true;
+    }
+    return redacted;
+}
+
+HttpResponse RecordingTransport::send(const HttpRequest &request)
+{
+    HttpResponse response = _transport->send(request);
+
+    nlohmann::json exchange;
+    exchange["method"] = request.method;
+    exchange["url"] = request.url;
+    exchange["requestBody"] = request.body;
+    exchange["status"] = response.statusCode;
+    exchange["headers"] = response.headers;
+    exchange["body"] = response.text;
+    exchange["elapsed"] = response.elapsed;
+    exchange["timings"] = { {"dns", response.timings.dns}, {"connect", response.timings.connect}, {"tls", response.timings.tls}, {"ttfb", response.timings.ttfb} };
+    exchange["bytesIn"] = response.bytesIn;
+    exchange["bytesOut"] = response.bytesOut;
+
+    // Token endpoints answer with credentials, keep them out of the recording. Parcel
+    // lists run to megabytes, parsing those would skew the timings being recorded.
+    if (carriesCredentials(request.url)) {
+        nlohmann::json body = nlohmann::json::parse(response.text, nullptr, false);
+        if (redact(body, { "authToken", "refreshToken" })) exchange["body"] = body.dump();
+
+        // So do the requests that sign in and refresh
+        nlohmann::json requestBody = nlohmann::json::parse(request.body, nullptr, false);
+        if (redact(requestBody, { "refreshToken", "code", "smsCode", "phoneNumber" })) exchange["requestBody"] = requestBody.dump();
+    }
+
+    QMutexLocker locker(&_mutex);
+    _file.write(QByteArray::fromStdString(exchange.dump() + "\n"));
+    _file.flush();
+
+    return response;
+}
@@ -0,0 +1,53 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECORDINGTRANSPORT_H
+#define RECORDINGTRANSPORT_H
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <initializer_list>
+#include <nlohmann/json.hpp>
+#include "httptransport.h"
+
+// Forwards to another transport and appends every exchange, with its timing, to a
+// JSON lines file that ReplayTransport can serve later. Tokens, SMS codes and phone
+// numbers are not written.
+class RecordingTransport : public HttpTransport
+{
+public:
+    RecordingTransport(std::unique_ptr<HttpTransport> transport, QString path);
+
+    HttpResponse send(const HttpRequest &request) override;
+
+private:
+    // Only the sign in and refresh endpoints exchange credentials, the rest is written as is
+    static bool carriesCredentials(const std::string &url);
+    // Replaces the values of the keys present, returns whether there were any
+    static bool redact(nlohmann::json &body, std::initializer_list<const char *> keys);
+
+private:
+    std::unique_ptr<HttpTransport> _transport;
+    QFile _file;
+    QMutex _mutex;
+};
+
+#endif // RECORDINGTRANSPORT_H
@@ -0,0 +1,119 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "apiclient.h"
+#include "parcellist.h"
+#include "refreshscheduler.h"
+
+RefreshScheduler::RefreshScheduler(ApiClient *apiClient, ParcelList *parcelList, QObject *parent) : QObject(parent),
+    _apiClient(apiClient), _parcelList(parcelList)
+{
+    _timer.setSingleShot(true);
+    // Minutes long waits, a few seconds of slack lets the system batch wakeups
+    _timer.setTimerType(Qt::VeryCoarseTimer);
+
+    connect(&_timer, &QTimer::timeout, this, &RefreshScheduler::onTimeout);
+    connect(_parcelList, &ParcelList::refreshed, this, &RefreshScheduler::onRefreshed);
+    connect(_apiClient, &ApiClient::rateLimited, this, &RefreshScheduler::onRateLimited);
+    connect(_apiClient, &ApiClient::needsAuthorizationChanged, this, &RefreshScheduler::reschedule);
+
+    _lastRefresh.start();
+    reschedule();
+}
+
+int RefreshScheduler::getInterval() const
+{
+    return _interval;
+}
+
+void RefreshScheduler::setApplicationState(Qt::ApplicationState state)
+{
+    bool active = state == Qt::ApplicationActive;
+    if (_active == active) return;
+
+    _active = active;
+    reschedule();
+}
+
+int RefreshScheduler::adaptiveInterval() const
+{
+    int interval = IDLE_INTERVAL;
+
+    for (const ParcelList::Parcel &parcel : _parcelList->getParcels()) {
+        switch (parcel.status) {
+        case ParcelList::ParcelStatus::OUT_FOR_DELIVERY:
+        case ParcelList::ParcelStatus::OUT_FOR_DELIVERY_TO_ADDRESS:
+        case ParcelList::ParcelStatus::READY_TO_PICKUP:
+        case ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_BRANCH:
+        case ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_POK:
+        case ParcelList::ParcelStatus::READY_TO_PICKUP_FROM_POK_REGISTERED:
+        case ParcelList::ParcelStatus::STACK_IN_BOX_MACHINE:
+        case ParcelList::ParcelStatus::STACK_IN_CUSTOMER_SERVICE_POINT:
+            return URGENT_INTERVAL;
+        default:
+            if (ParcelList::isPending(parcel.status)) interval = PENDING_INTERVAL;
+        }
+    }
+
+    return interval;
+}
+
+void RefreshScheduler::reschedule()
+{
+    int interval = adaptiveInterval();
+
+    // Nothing is on its way, the user will reload when they come back
+    if (_apiClient->getNeedsAuthorization() || (!_active && interval == IDLE_INTERVAL)) interval = 0;
+
+    if (_interval != interval) {
+        _interval = interval;
+        emit intervalChanged();
+    }
+
+    if (interval == 0) {
+        _timer.stop();
+        return;
+    }
+
+    qint64 delay = qMax<qint64>(0, interval * 1000LL - _lastRefresh.elapsed());
+    if (_rateLimited.isValid()) delay = qMax(delay, _rateLimitedFor - _rateLimited.elapsed());
+
+    _timer.start(static_cast<int>(delay));
+}
+
+void RefreshScheduler::onRefreshed()
+{
+    _lastRefresh.restart();
+    reschedule();
+}
+
+void RefreshScheduler::onRateLimited(int seconds)
+{
+    _rateLimitedFor = (seconds >= 0 ? seconds : RATE_LIMIT_BACKOFF) * 1000LL;
+    _rateLimited.start();
+    reschedule();
+}
+
+void RefreshScheduler::onTimeout()
+{
+    if (_parcelList->getLoading()) return;
+
+    _parcelList->refresh();
+}
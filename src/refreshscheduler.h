@@ -0,0 +1,73 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+class ApiClient;
+class ParcelList;
+
+// Refreshes the parcel list on its own, often while a parcel is about to arrive or waits
+// in a locker and rarely once everything is delivered. Polling stops in the background
+// unless something is still on its way, and a 429 holds it off for the Retry-After time.
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int interval READ getInterval NOTIFY intervalChanged)
+public:
+    static const int URGENT_INTERVAL = 5 * 60;
+    static const int PENDING_INTERVAL = 30 * 60;
+    static const int IDLE_INTERVAL = 4 * 60 * 60;
+    // Used when a 429 comes without Retry-After
+    static const int RATE_LIMIT_BACKOFF = 5 * 60;
+
+    RefreshScheduler(ApiClient *apiClient, ParcelList *parcelList, QObject *parent = nullptr);
+
+    // Seconds between refreshes, 0 while paused
+    int getInterval() const;
+
+    void setApplicationState(Qt::ApplicationState state);
+
+signals:
+    void intervalChanged();
+
+private:
+    int adaptiveInterval() const;
+    void reschedule();
+    void onRefreshed();
+    void onRateLimited(int seconds);
+    void onTimeout();
+
+private:
+    ApiClient *_apiClient;
+    ParcelList *_parcelList;
+    QTimer _timer;
+    QElapsedTimer _lastRefresh;
+    QElapsedTimer _rateLimited;
+    qint64 _rateLimitedFor = 0;
+    int _interval = 0;
+    bool _active = true;
+};
+
+#endif // REFRESHSCHEDULER_H
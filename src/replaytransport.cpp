@@ -0,0 +1,104 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "replaytransport.h"
+
+ReplayTransport::ReplayTransport(QString path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Can't open HTTP recording" << path;
+        return;
+    }
+
+    while (!file.atEnd()) {
+        nlohmann::json exchange = nlohmann::json::parse(file.readLine().toStdString(), nullptr, false);
+        if (!exchange.is_object()) continue;
+
+        HttpResponse response;
+        response.statusCode = exchange.value("status", 0L);
+        response.text = exchange.value("body", "");
+        response.elapsed = exchange.value("elapsed", 0.0);
+        if (exchange.contains("headers") && exchange["headers"].is_object()) {
+            response.headers = exchange["headers"].get<HttpHeaders>();
+        }
+        if (exchange.contains("timings") && exchange["timings"].is_object()) {
+            const nlohmann::json &timings = exchange["timings"];
+            response.timings.dns = timings.value("dns", 0.0);
+            response.timings.connect = timings.value("connect", 0.0);
+            response.timings.tls = timings.value("tls", 0.0);
+            response.timings.ttfb = timings.value("ttfb", 0.0);
+        }
+        response.bytesIn = exchange.value("bytesIn", std::uint64_t(0));
+        response.bytesOut = exchange.value("bytesOut", std::uint64_t(0));
+
+        _exchanges[exchange.value("method", "") + " " + exchange.value("url", "")].responses.push_back(response);
+    }
+}
+
+void ReplayTransport::setLatency(int milliseconds)
+{
+    _latency = milliseconds;
+}
+
+void ReplayTransport::injectStatus(long statusCode)
+{
+    QMutexLocker locker(&_mutex);
+    _injected.enqueue(statusCode);
+}
+
+HttpResponse ReplayTransport::send(const HttpRequest &request)
+{
+    if (_latency > 0) QThread::msleep(_latency);
+
+    QMutexLocker locker(&_mutex);
+    HttpResponse response;
+
+    if (!_injected.isEmpty()) {
+        response.statusCode = _injected.dequeue();
+        if (response.statusCode == 429) response.headers["retry-after"] = "1";
+        return response;
+    }
+
+    auto exchange = _exchanges.find(request.method + " " + request.url);
+    if (exchange == _exchanges.end() || exchange->second.responses.empty()) {
+        // Unknown requests behave like the network being down
+        return response;
+    }
+
+    Responses &recorded = exchange->second;
+    response = recorded.responses[std::min(recorded.next, recorded.responses.size() - 1)];
+    recorded.next++;
+
+    auto etag = response.headers.find("etag");
+    auto ifNoneMatch = request.headers.find("If-None-Match");
+    if (response.statusCode == 200 && etag != response.headers.end() && ifNoneMatch != request.headers.end() && etag->second == ifNoneMatch->second) {
+        response.statusCode = 304;
+        response.text.clear();
+    }
+
+    return response;
+}
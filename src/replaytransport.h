@@ -0,0 +1,55 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef REPLAYTRANSPORT_H
+#define REPLAYTRANSPORT_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <map>
+#include <vector>
+#include "httptransport.h"
+
+// Serves exchanges saved by RecordingTransport without touching the network. Repeated
+// requests get the recorded responses in order, the last one is served from then on.
+class ReplayTransport : public HttpTransport
+{
+public:
+    explicit ReplayTransport(QString path);
+
+    void setLatency(int milliseconds);
+    void injectStatus(long statusCode);
+
+    HttpResponse send(const HttpRequest &request) override;
+
+private:
+    struct Responses {
+        std::vector<HttpResponse> responses;
+        std::size_t next = 0;
+    };
+
+    int _latency = 0;
+    QQueue<long> _injected;
+    std::map<std::string, Responses> _exchanges;
+    QMutex _mutex;
+};
+
+#endif // REPLAYTRANSPORT_H
@@ -0,0 +1,104 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QMutexLocker>
+#include <QUrl>
+#include "sessionpool.h"
+
+SessionPool::SessionPool(cpr::Header header) : _header(header)
+{
+    _share = curl_share_init();
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &SessionPool::lockShare);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &SessionPool::unlockShare);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+    // Only DNS and TLS sessions, libcurl can't share a connection cache between threads.
+    // Connections are kept by the pooled sessions themselves, each easy handle has its own.
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+SessionPool::~SessionPool()
+{
+    _idle.clear();
+    curl_share_cleanup(_share);
+}
+
+SessionPool::Session SessionPool::acquire(const std::string &url, const std::string &kind)
+{
+    std::string key = QUrl(QString::fromStdString(url)).host().toStdString() + " " + kind;
+    std::unique_ptr<cpr::Session> session;
+
+    {
+        QMutexLocker locker(&_mutex);
+        std::vector<std::unique_ptr<cpr::Session>> &idle = _idle[key];
+        if (!idle.empty()) {
+            session = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+
+    if (!session) session = createSession();
+
+    // Drop per-request headers left over from the previous lease
+    session->SetHeader(_header);
+
+    return Session(session.release(), [this, key](cpr::Session *session) {
+        release(key, session);
+    });
+}
+
+std::unique_ptr<cpr::Session> SessionPool::createSession()
+{
+    std::unique_ptr<cpr::Session> session = std::make_unique<cpr::Session>();
+    session->SetHeader(_header);
+    session->SetHttpVersion(cpr::HttpVersion{cpr::HttpVersionCode::VERSION_2_0_TLS});
+
+    // Only ask for brotli when curl is able to decode it
+    if (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_BROTLI) {
+        session->SetAcceptEncoding(cpr::AcceptEncoding{"gzip", "br"});
+    } else {
+        session->SetAcceptEncoding(cpr::AcceptEncoding{"gzip"});
+    }
+
+    CURL *handle = session->GetCurlHolder()->handle;
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_SHARE, _share);
+
+    return session;
+}
+
+void SessionPool::release(const std::string &key, cpr::Session *session)
+{
+    QMutexLocker locker(&_mutex);
+    _idle[key].emplace_back(session);
+}
+
+void SessionPool::lockShare(CURL *handle, curl_lock_data data, curl_lock_access access, void *pool)
+{
+    Q_UNUSED(handle)
+    Q_UNUSED(access)
+    static_cast<SessionPool*>(pool)->_shareLocks[data].lock();
+}
+
+void SessionPool::unlockShare(CURL *handle, curl_lock_data data, void *pool)
+{
+    Q_UNUSED(handle)
+    static_cast<SessionPool*>(pool)->_shareLocks[data].unlock();
+}
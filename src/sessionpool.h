@@ -0,0 +1,60 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SESSIONPOOL_H
+#define SESSIONPOOL_H
+
+#include <QMutex>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cpr/cpr.h>
+
+// Keeps configured cpr sessions alive between requests so their connections,
+// TLS sessions and DNS entries are reused instead of being set up per call.
+// Sessions are not thread safe, each one is leased to a single request at a time.
+class SessionPool
+{
+public:
+    typedef std::shared_ptr<cpr::Session> Session;
+
+    explicit SessionPool(cpr::Header header);
+    ~SessionPool();
+
+    Session acquire(const std::string &url, const std::string &kind);
+
+private:
+    std::unique_ptr<cpr::Session> createSession();
+    void release(const std::string &key, cpr::Session *session);
+
+    static void lockShare(CURL *handle, curl_lock_data data, curl_lock_access access, void *pool);
+    static void unlockShare(CURL *handle, curl_lock_data data, void *pool);
+
+private:
+    const cpr::Header _header;
+    CURLSH *_share;
+    std::mutex _shareLocks[CURL_LOCK_DATA_LAST];
+    QMutex _mutex;
+    std::map<std::string, std::vector<std::unique_ptr<cpr::Session>>> _idle;
+};
+
+#endif // SESSIONPOOL_H
@@ -0,0 +1,101 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SHIPMENTNUMBER_H
+#define SHIPMENTNUMBER_H
+
+#include <QHash>
+#include <QString>
+#include <cstring>
+
+// InPost shipment numbers are 24 digits, they are kept inline instead of in a heap
+// allocated QString. Anything that doesn't fit, like foreign courier numbers, falls
+// back to a QString.
+class ShipmentNumber
+{
+public:
+    static const int CAPACITY = 24;
+
+    ShipmentNumber() = default;
+
+    explicit ShipmentNumber(const QString &number)
+    {
+        bool fits = number.size() <= CAPACITY;
+        for (int i = 0; fits && i < number.size(); i++) fits = number[i].unicode() < 0x80;
+
+        if (!fits) {
+            _other = number;
+            return;
+        }
+
+        for (int i = 0; i < number.size(); i++) _chars[i] = static_cast<char>(number[i].unicode());
+        _size = static_cast<quint8>(number.size());
+    }
+
+    explicit ShipmentNumber(const std::string &number)
+    {
+        if (number.size() > static_cast<std::size_t>(CAPACITY)) {
+            _other = QString::fromStdString(number);
+            return;
+        }
+
+        for (char c : number) {
+            if (static_cast<unsigned char>(c) >= 0x80) {
+                _other = QString::fromStdString(number);
+                return;
+            }
+        }
+
+        std::memcpy(_chars, number.data(), number.size());
+        _size = static_cast<quint8>(number.size());
+    }
+
+    QString toString() const
+    {
+        return _other.isNull() ? QString::fromLatin1(_chars, _size) : _other;
+    }
+
+    bool isEmpty() const
+    {
+        return _size == 0 && _other.isEmpty();
+    }
+
+    bool operator==(const ShipmentNumber &other) const
+    {
+        return _size == other._size && std::memcmp(_chars, other._chars, _size) == 0 && _other == other._other;
+    }
+
+    bool operator!=(const ShipmentNumber &other) const
+    {
+        return !(*this == other);
+    }
+
+    friend uint qHash(const ShipmentNumber &number, uint seed = 0)
+    {
+        return number._other.isNull() ? qHashBits(number._chars, number._size, seed) : qHash(number._other, seed);
+    }
+
+private:
+    char _chars[CAPACITY] = {};
+    quint8 _size = 0;
+    QString _other;
+};
+
+#endif // SHIPMENTNUMBER_H
@@ -0,0 +1,99 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QAbstractItemModel>
+#include <QDebug>
+#include <QFile>
+#include <QQuickWindow>
+#include <QStringList>
+#include <unistd.h>
+#include "startuptrace.h"
+
+StartupTrace::StartupTrace()
+{
+    _timer.start();
+    _enabled = !qgetenv("OUTPOST_STARTUP_TRACE").isEmpty();
+    if (_enabled) _offset = sinceProcessStart();
+
+    _timeout.setSingleShot(true);
+    connect(&_timeout, &QTimer::timeout, this, &StartupTrace::finish);
+}
+
+void StartupTrace::mark(const char *phase)
+{
+    if (!_enabled) return;
+
+    qint64 now = _offset + _timer.elapsed();
+    qInfo("startup: %-14s %6lld ms %+6lld ms", phase, now, now - _last);
+    _last = now;
+}
+
+void StartupTrace::watch(QQuickWindow *window, QAbstractItemModel *parcels, std::function<void()> deferred)
+{
+    _parcels = parcels;
+    _deferred = deferred;
+
+    // Swapped on the render thread, handled here
+    _frames = connect(window, &QQuickWindow::frameSwapped, this, &StartupTrace::onFrameSwapped);
+}
+
+void StartupTrace::onFrameSwapped()
+{
+    if (!_firstFrame) {
+        _firstFrame = true;
+        mark("first frame");
+        _timeout.start(TIMEOUT);
+
+        // After this frame's events, not in the middle of them
+        std::function<void()> deferred = _deferred;
+        _deferred = nullptr;
+        QTimer::singleShot(0, this, [this, deferred]() {
+            if (deferred) deferred();
+            mark("deferred");
+        });
+    }
+
+    if (_parcels->rowCount() > 0) {
+        mark("first parcel");
+        finish();
+    }
+}
+
+void StartupTrace::finish()
+{
+    disconnect(_frames);
+    _timeout.stop();
+}
+
+qint64 StartupTrace::sinceProcessStart()
+{
+    // Field 22 of /proc/self/stat is the start time in clock ticks since boot, the
+    // process name before it may hold spaces but ends with ')'
+    QFile stat("/proc/self/stat"), uptime("/proc/uptime");
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) return 0;
+
+    QByteArray line = stat.readAll();
+    QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    double now = uptime.readAll().split(' ').value(0).toDouble();
+    if (fields.size() < 20) return 0;
+
+    double started = fields[19].toDouble() / sysconf(_SC_CLK_TCK);
+    return qMax<qint64>(0, static_cast<qint64>((now - started) * 1000));
+}
@@ -0,0 +1,65 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+
+class QAbstractItemModel;
+class QQuickWindow;
+
+// Times startup phases from process start to the first frame showing parcels, printed
+// when OUTPOST_STARTUP_TRACE is set. It also runs the work startup can do without
+// once the first frame is out.
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+public:
+    // Parcels showing up later than this are a refresh, not startup
+    static const int TIMEOUT = 10000;
+
+    StartupTrace();
+
+    void mark(const char *phase);
+    void watch(QQuickWindow *window, QAbstractItemModel *parcels, std::function<void()> deferred);
+
+private:
+    void onFrameSwapped();
+    void finish();
+    static qint64 sinceProcessStart();
+
+private:
+    QElapsedTimer _timer;
+    // Milliseconds between process start and the timer starting
+    qint64 _offset = 0;
+    qint64 _last = 0;
+    bool _enabled = false;
+    bool _firstFrame = false;
+    QAbstractItemModel *_parcels = nullptr;
+    QMetaObject::Connection _frames;
+    std::function<void()> _deferred;
+    QTimer _timeout;
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,130 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDataStream>
+#include <QDebug>
+#include "parcelparser.h"
+#include "parcelsnapshot.h"
+#include "syncclient.h"
+#include "syncservice.h"
+
+SyncClient::SyncClient(QObject *parent) : QObject(parent), _bus(QDBusConnection::sessionBus())
+{
+    _watcher.setConnection(_bus);
+    _watcher.addWatchedService(SyncService::SERVICE);
+    connect(&_watcher, &QDBusServiceWatcher::serviceRegistered, this, [this]() {
+        setAvailable(true);
+    });
+    connect(&_watcher, &QDBusServiceWatcher::serviceUnregistered, this, [this]() {
+        setAvailable(false);
+    });
+
+    _bus.connect(SyncService::SERVICE, SyncService::PATH, SyncService::INTERFACE, "ParcelsChanged", this, SIGNAL(parcelsChanged()));
+    _bus.connect(SyncService::SERVICE, SyncService::PATH, SyncService::INTERFACE, "AuthorizationChanged", this, SIGNAL(authorizationChanged()));
+
+    _available = _bus.isConnected() && _bus.interface()->isServiceRegistered(SyncService::SERVICE);
+}
+
+bool SyncClient::isAvailable() const
+{
+    return _available;
+}
+
+void SyncClient::start()
+{
+    if (_available || !_bus.isConnected()) return;
+
+    // Without waiting, the watcher reports when it is there
+    QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus", "StartServiceByName");
+    message << QString(SyncService::SERVICE) << 0u;
+    _bus.asyncCall(message);
+}
+
+void SyncClient::getParcels(int listType, bool force, ParcelsHandler handler)
+{
+    QDBusMessage message = call("GetParcels");
+    message << listType << force;
+
+    auto *watcher = new QDBusPendingCallWatcher(_bus.asyncCall(message, 60 * 1000), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [watcher, handler]() {
+        watcher->deleteLater();
+
+        QDBusPendingReply<QByteArray, qulonglong> reply = *watcher;
+        if (reply.isError()) {
+            qDebug() << "Sync daemon:" << reply.error().message();
+            handler(nullptr, 0);
+            return;
+        }
+
+        QByteArray bytes = reply.argumentAt<0>();
+        QDataStream stream(bytes);
+        stream.setVersion(QDataStream::Qt_5_6);
+
+        std::shared_ptr<ParcelPayload> payload = std::make_shared<ParcelPayload>();
+        if (!ParcelSnapshot::readParcels(stream, payload->parcels, payload->compartments)) {
+            handler(nullptr, 0);
+            return;
+        }
+
+        handler(payload, reply.argumentAt<1>());
+    });
+}
+
+void SyncClient::setTracking(const QString &number, bool tracked, std::function<void(long statusCode)> handler)
+{
+    QDBusMessage message = call("SetTracking");
+    message << number << tracked;
+
+    auto *watcher = new QDBusPendingCallWatcher(_bus.asyncCall(message, 60 * 1000), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [watcher, handler]() {
+        watcher->deleteLater();
+
+        // An unreachable daemon is a network failure to the caller, it gets retried
+        QDBusPendingReply<int> reply = *watcher;
+        handler(reply.isError() ? 0 : reply.value());
+    });
+}
+
+void SyncClient::reloadAccount()
+{
+    _bus.asyncCall(call("ReloadAccount"));
+}
+
+void SyncClient::logout()
+{
+    _bus.asyncCall(call("Logout"));
+}
+
+QDBusMessage SyncClient::call(const QString &method) const
+{
+    return QDBusMessage::createMethodCall(SyncService::SERVICE, SyncService::PATH, SyncService::INTERFACE, method);
+}
+
+void SyncClient::setAvailable(bool available)
+{
+    if (_available == available) return;
+
+    _available = available;
+    emit availableChanged();
+}
@@ -0,0 +1,68 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SYNCCLIENT_H
+#define SYNCCLIENT_H
+
+#include <QDBusConnection>
+#include <QDBusServiceWatcher>
+#include <QObject>
+#include <functional>
+#include <memory>
+
+struct ParcelPayload;
+
+// The application side of SyncService. While the daemon is on the session bus the
+// API client goes through it instead of the network.
+class SyncClient : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void(std::shared_ptr<const ParcelPayload> data, quint64 revision)> ParcelsHandler;
+
+    explicit SyncClient(QObject *parent = nullptr);
+
+    bool isAvailable() const;
+    // Asks the bus to start the daemon, availableChanged() follows once it is up
+    void start();
+
+    void getParcels(int listType, bool force, ParcelsHandler handler);
+    void setTracking(const QString &number, bool tracked, std::function<void(long statusCode)> handler);
+    void reloadAccount();
+    void logout();
+
+signals:
+    void availableChanged();
+    // The daemon synced new data
+    void parcelsChanged();
+    // The daemon signed in or out, reload the account from the settings
+    void authorizationChanged();
+
+private:
+    QDBusMessage call(const QString &method) const;
+    void setAvailable(bool available);
+
+private:
+    QDBusConnection _bus;
+    QDBusServiceWatcher _watcher;
+    bool _available = false;
+};
+
+#endif // SYNCCLIENT_H
@@ -0,0 +1,103 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <QDBusMessage>
+#include <QDataStream>
+#include <QDebug>
+#include "apiclient.h"
+#include "parcelparser.h"
+#include "parcelsnapshot.h"
+#include "syncservice.h"
+
+SyncService::SyncService(ApiClient *apiClient, QObject *parent) : QObject(parent), _apiClient(apiClient)
+{
+    connect(_apiClient, &ApiClient::parcelsSynced, this, &SyncService::ParcelsChanged);
+    connect(_apiClient, &ApiClient::needsAuthorizationChanged, this, &SyncService::AuthorizationChanged);
+}
+
+bool SyncService::registerOn(QDBusConnection connection)
+{
+    if (!connection.registerObject(PATH, this, QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals)) return false;
+    return connection.registerService(SERVICE);
+}
+
+QByteArray SyncService::GetParcels(int listType, bool force, qulonglong &revision)
+{
+    revision = 0;
+    if (listType < ApiClient::Pending || listType > ApiClient::Returns) {
+        sendErrorReply(QDBusError::InvalidArgs, "Unknown list type");
+        return QByteArray();
+    }
+
+    // Answered once the API client has the list, from its cache or the network
+    setDelayedReply(true);
+    QDBusMessage request = message();
+    QDBusConnection bus = connection();
+
+    _apiClient->getParcels(static_cast<ApiClient::ParcelListType>(listType), [this, request, bus](std::shared_ptr<const ParcelPayload> data, quint64 revision) mutable {
+        if (!data) {
+            bus.send(request.createErrorReply(QDBusError::Failed, "Fetching parcels failed"));
+            return;
+        }
+
+        bus.send(request.createReply(QVariantList() << encode(*data, revision) << QVariant::fromValue<qulonglong>(revision)));
+    }, force);
+
+    return QByteArray();
+}
+
+int SyncService::SetTracking(const QString &number, bool tracked)
+{
+    setDelayedReply(true);
+    QDBusMessage request = message();
+    QDBusConnection bus = connection();
+
+    _apiClient->setTracking(number, tracked, [request, bus](long statusCode) mutable {
+        bus.send(request.createReply(static_cast<int>(statusCode)));
+    });
+
+    return 0;
+}
+
+void SyncService::ReloadAccount()
+{
+    _apiClient->reloadAccount();
+}
+
+void SyncService::Logout()
+{
+    _apiClient->logout();
+}
+
+QByteArray SyncService::encode(const ParcelPayload &payload, quint64 revision)
+{
+    auto encoded = _encoded.constFind(revision);
+    if (encoded != _encoded.constEnd()) return encoded.value();
+
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    ParcelSnapshot::writeParcels(stream, payload.parcels, payload.compartments);
+
+    // One per endpoint is all that gets asked for again
+    if (_encoded.size() >= 4) _encoded.clear();
+    _encoded.insert(revision, bytes);
+    return bytes;
+}
@@ -0,0 +1,71 @@
+/*
+
+This file is part of Outpost.
+Copyright 2023, Michał Szczepaniak <m.szczepaniak.000@gmail.com>
+
+Outpost is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Outpost is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Yottagram. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SYNCSERVICE_H
+#define SYNCSERVICE_H
+
+#include <QByteArray>
+#include <QDBusConnection>
+#include <QDBusContext>
+#include <QHash>
+#include <QObject>
+
+class ApiClient;
+struct ParcelPayload;
+
+// The daemon side of the session bus API. Parcel lists come from the daemon's API
+// cache, so every client shares its connections, tokens, refreshes and parsed data.
+class SyncService : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.verdanditeam.outpost.Sync")
+public:
+    static constexpr const char *SERVICE = "com.verdanditeam.outpost";
+    static constexpr const char *PATH = "/Sync";
+    static constexpr const char *INTERFACE = "com.verdanditeam.outpost.Sync";
+
+    explicit SyncService(ApiClient *apiClient, QObject *parent = nullptr);
+
+    bool registerOn(QDBusConnection connection);
+
+public slots:
+    // Parcels in the ParcelSnapshot encoding, and their revision
+    Q_SCRIPTABLE QByteArray GetParcels(int listType, bool force, qulonglong &revision);
+    // The HTTP status, 0 when the server couldn't be reached
+    Q_SCRIPTABLE int SetTracking(const QString &number, bool tracked);
+    // The application signed in, the account is in the shared settings
+    Q_SCRIPTABLE void ReloadAccount();
+    Q_SCRIPTABLE void Logout();
+
+signals:
+    Q_SCRIPTABLE void ParcelsChanged();
+    // Signed in or out, the account is in the shared settings
+    Q_SCRIPTABLE void AuthorizationChanged();
+
+private:
+    QByteArray encode(const ParcelPayload &payload, quint64 revision);
+
+private:
+    ApiClient *_apiClient;
+    // Encoded payloads by revision, Pending and Tracked ask for the same one
+    QHash<quint64, QByteArray> _encoded;
+};
+
+#endif // SYNCSERVICE_H